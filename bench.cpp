@@ -0,0 +1,256 @@
+//SYS LIBRARIES
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+
+#include "evGenerator.h"
+#include "lundWriter.h"
+
+using namespace std;
+
+// Timings of the hot paths of the generator: the cross section (point by
+// point, in batches and from the table of --tabulate, low and high Q2),
+// the envelope scan, the making of the table, cms2lab, the
+// decays, getEvent with the accept-reject and the lund writer. The points
+// and seeds are fixed, so two versions run the same work: compare the
+// ns/op, and the checksum tells if the results changed too.
+//
+// usage: benchKYandOnePion [--json=file] [dataPath]   (default: $DataKYandOnePion)
+// make bench writes bench.json
+
+struct BenchResult {
+  string name;
+  long long ops;
+  double seconds;
+  double checksum;
+};
+
+vector<BenchResult> results;
+
+// run f (it does ops operations and returns a checksum) a few times and
+// keep the fastest run
+template <class F>
+void measure(const string& name, long long ops, F f, int repeat = 3) {
+  BenchResult r = {name, ops, 1e300, 0.};
+  for(int i=0; i<repeat; i++) {
+    auto start = chrono::steady_clock::now();
+    double sum = f();
+    double t = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if(t < r.seconds) r.seconds = t;
+    r.checksum = sum;
+  }
+  results.push_back(r);
+  printf(" %-32s %12.1f ns/op %14.0f op/s\n", name.c_str(), 1e9*r.seconds/ops, ops/r.seconds);
+  fflush(stdout);
+}
+
+// fixed set of points in (Q2, W, cosThetaK, phiK)
+struct PointSet {
+  vector<double> Q2, W, cosThetaK, phiK;
+  PointSet(int n, double q2min, double q2max, double wmin, double wmax, unsigned seed) {
+    mt19937_64 engine(seed);
+    uniform_real_distribution<double> u(0., 1.);
+    for(int i=0; i<n; i++) {
+      Q2.push_back(q2min + (q2max-q2min)*u(engine));
+      W.push_back(wmin + (wmax-wmin)*u(engine));
+      cosThetaK.push_back(-1. + 2.*u(engine));
+      phiK.push_back(2.*constantPi*u(engine));
+    }
+  }
+  int size() const { return Q2.size(); }
+};
+
+// fixed set of moving particles of mass m
+vector<FourVector> particles(int n, double m, unsigned seed) {
+  mt19937_64 engine(seed);
+  uniform_real_distribution<double> u(0., 1.);
+  vector<FourVector> v(n);
+  for(int i=0; i<n; i++) {
+    double p = 0.2 + 4.*u(engine), cosTh = -1. + 2.*u(engine), phi = 2.*constantPi*u(engine);
+    double sinTh = sqrt(1. - cosTh*cosTh);
+    v[i].px = p*sinTh*cos(phi);
+    v[i].py = p*sinTh*sin(phi);
+    v[i].pz = p*cosTh;
+    v[i].E = sqrt(p*p + m*m);
+  }
+  return v;
+}
+
+vector<double> uniforms(int n, unsigned seed) {
+  mt19937_64 engine(seed);
+  uniform_real_distribution<double> u(0., 1.);
+  vector<double> v(n);
+  // (0, 1] as the ROOT generators
+  for(int i=0; i<n; i++) v[i] = 1. - u(engine);
+  return v;
+}
+
+bool writeJson(const string& path) {
+  FILE* f = path == "-" ? stdout : fopen(path.c_str(), "w");
+  if(f == NULL) {
+    cerr << " Error! can not write " << path << endl;
+    return false;
+  }
+  fprintf(f, "{\n  \"benchmarks\": [\n");
+  for(size_t i=0; i<results.size(); i++) {
+    const BenchResult &r = results[i];
+    fprintf(f, "    {\"name\": \"%s\", \"ops\": %lld, \"seconds\": %.6g, \"ns_per_op\": %.6g, \"ops_per_second\": %.6g, \"checksum\": %.17g}%s\n",
+            r.name.c_str(), r.ops, r.seconds, 1e9*r.seconds/r.ops, r.ops/r.seconds, r.checksum,
+            i+1 < results.size() ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+  bool ok = ferror(f) == 0;
+  if(f != stdout) ok = (fclose(f) == 0) && ok;
+  if(!ok) cerr << " Error! can not write " << path << endl;
+  return ok;
+}
+
+
+int main(int argc, char *argv[]) {
+
+  string dataPath, jsonPath;
+  for(int i=1; i<argc; i++) {
+    if(strncmp(argv[i], "--json=", 7) == 0) jsonPath = argv[i] + 7;
+    else dataPath = argv[i];
+  }
+  if(dataPath.empty() && getenv("DataKYandOnePion") != NULL) dataPath = getenv("DataKYandOnePion");
+  if(dataPath.empty()) {
+    cerr << "ERROR! Set DataKYandOnePion environment variable or give the data path" << endl;
+    return 1;
+  }
+
+  const double Ebeam = 10.6;
+  const char* names[4] = {"KLambda", "KSigma", "Pi0P", "PiN"};
+  // W from above the threshold of the channel
+  const double Wlow[4] = {1.65, 1.72, 1.1, 1.1};
+  const double Whigh[4] = {2.6, 2.6, 2.2, 2.2};
+  const int nPoints = 20000;
+  // nodes of the d5sigma table, those of evGenerator
+  const int tableNodes[3] = {81, 161, 81};
+
+  // cross section: low Q2 interpolates the tables, high Q2 extrapolates them
+  for(int ch=1; ch<=4; ch++) {
+    Sigma model(dataPath, ch);
+    string name = names[ch-1];
+    PointSet low(nPoints, 0.5, 4., Wlow[ch-1], Whigh[ch-1], 1);
+    PointSet high(nPoints, 5.5, 9., Wlow[ch-1], Whigh[ch-1], 2);
+    const PointSet* sets[2] = {&low, &high};
+    const char* regimes[2] = {"lowQ2", "highQ2"};
+    SigmaTable table;
+    measure("d5sigma_table_build/" + name, 1, [&]() {
+      table.build(model, ch, Ebeam, 0.5, 9., Wlow[ch-1], Whigh[ch-1], tableNodes, 1);
+      return 0.;
+    }, 1);
+    for(int r=0; r<2; r++) {
+      const PointSet &p = *sets[r];
+      measure("d5sigma/" + name + "/" + regimes[r], p.size(), [&]() {
+        double sum = 0.;
+        for(int i=0; i<p.size(); i++) sum += model.d5sigma(Ebeam, p.Q2[i], p.W[i], acos(p.cosThetaK[i]), p.phiK[i]);
+        return sum;
+      });
+      vector<double> out(p.size());
+      measure("d5sigma_batch/" + name + "/" + regimes[r], p.size(), [&]() {
+        model.d5sigma(Ebeam, p.size(), &p.Q2[0], &p.W[0], &p.cosThetaK[0], &p.phiK[0], &out[0]);
+        double sum = 0.;
+        for(int i=0; i<p.size(); i++) sum += out[i];
+        return sum;
+      });
+      measure("d5sigma_table/" + name + "/" + regimes[r], p.size(), [&]() {
+        double sum = 0.;
+        for(int i=0; i<p.size(); i++) sum += table.d5sigma(p.Q2[i], p.W[i], p.cosThetaK[i], p.phiK[i]);
+        return sum;
+      });
+    }
+    measure("d5sigma_max/" + name, 1, [&]() {
+      return model.d5sigma_max(Ebeam, 0.5, 4., Wlow[ch-1], Whigh[ch-1], 1);
+    }, 1);
+  }
+
+  // kinematics
+  {
+    PointSet p(nPoints, 0.5, 4., 1.65, 2.6, 3);
+    vector<double> phi = uniforms(nPoints, 4);
+    measure("cms2lab", p.size(), [&]() {
+      double sum = 0.;
+      for(int i=0; i<p.size(); i++) {
+        FourVector K, L;
+        cms2lab(p.W[i], p.Q2[i], 2.*constantPi*phi[i], Ebeam, acos(p.cosThetaK[i]), p.phiK[i],
+                massKaon, massLambda, K, L);
+        sum += K.pz + L.E;
+      }
+      return sum;
+    });
+  }
+
+  // decays of a batch of parents
+  {
+    struct Mode { const char* name; const TwoBodyDecay *decay; double m; };
+    Mode modes[4] = {{"Lambda", &decayLambda, massLambda}, {"Sigma0", &decaySigma0, massSigma0},
+                     {"Lambda1520", &decayLambda1520, massLambda1520}, {"Pi0", &decayPi0, massPion0}};
+    vector<double> u = uniforms(2*nPoints, 5);
+    vector<FourVector> d1(nPoints), d2(nPoints);
+    for(int m=0; m<4; m++) {
+      vector<FourVector> parent = particles(nPoints, modes[m].m, 6+m);
+      measure(string("decay/") + modes[m].name, nPoints, [&]() {
+        modes[m].decay->decay(nPoints, &parent[0], &u[0], &d1[0], &d2[0]);
+        double sum = 0.;
+        for(int i=0; i<nPoints; i++) sum += d1[i].pz + d2[i].E;
+        return sum;
+      });
+    }
+    vector<FourVector> lambda = particles(nPoints, massLambda, 10);
+    vector<double> vertex(3*nPoints);
+    measure("decay/Lambda_vertex", nPoints, [&]() {
+      fill(vertex.begin(), vertex.end(), 0.);
+      moveToDecayVertex(nPoints, &lambda[0], cTauLambda, &u[0], &vertex[0]);
+      double sum = 0.;
+      for(int i=0; i<3*nPoints; i++) sum += vertex[i];
+      return sum;
+    });
+  }
+
+  // events with the accept-reject (flat proposal), then the lund writer
+  vector<Event> events;
+  for(int ch=1; ch<=4; ch++) {
+    string name = names[ch-1];
+    evGenerator gen(dataPath, name, Ebeam, 0.5, 4., Wlow[ch-1], Whigh[ch-1], 1, false, false, "flat", 1);
+    const int nEvents = 2000;
+    measure("getEvent/" + name, nEvents, [&]() {
+      gen.setSeed(7);
+      gen.resetStatistics();
+      double sum = 0.;
+      for(int i=0; i<nEvents; i++) {
+        Event ev = Event();
+        gen.getEvent(ev.Q2, ev.W, ev.Pefin, ev.PK, ev.PL);
+        sum += ev.Q2 + ev.PK.Pz();
+        if(ch == 1) events.push_back(ev);
+      }
+      return sum;
+    }, 1);
+    cout << "   " << name << ": " << (double)gen.getStatistics().nTrials/nEvents << " proposals per event" << endl;
+  }
+
+  {
+    LundWriter writer(1, false, false, false, false);
+    for(size_t i=0; i<events.size(); i++) events[i].v_prod = {0., 0., 0.};
+    string text;
+    const int reps = 10;
+    measure("lund_writer", reps*events.size(), [&]() {
+      size_t bytes = 0;
+      for(int r=0; r<reps; r++) {
+        text.clear();
+        for(size_t i=0; i<events.size(); i++) writer.write(text, events[i]);
+        bytes += text.size();
+      }
+      return (double)bytes;
+    });
+  }
+
+  if(!jsonPath.empty() && !writeJson(jsonPath)) return 1;
+  return 0;
+}
@@ -0,0 +1,194 @@
+#ifndef _CELL_ENVELOPE_H
+#define _CELL_ENVELOPE_H
+
+//SYS LIBRARIES
+#include <cmath>
+#include <vector>
+
+#include "utils.h"
+
+using namespace std;
+
+// Piecewise-constant majorant of the cross section.
+// The box in (Q2, W, cosThetaK, phiK) is split into equal cells, every cell
+// gets an upper bound of d5sigma taken from a lattice of nodes (corners and
+// the centre of every edge of the cell) times a safety factor.
+// Cells are picked with probability bound*volume through a Walker alias
+// table (two random numbers, O(1)), the point is uniform inside the cell
+// and is accepted against the bound of its own cell.
+class CellEnvelope {
+
+  static const int nDim = 4;
+  int nCells[nDim];
+  double xMin[nDim];
+  double xMax[nDim];
+  double width[nDim];
+  int total;
+
+  vector<double> bound;     // upper bound of d5sigma per cell
+  vector<double> prob;      // alias table: probability to keep the cell
+  vector<int>    alias;     // alias table: the other cell of the column
+  double integral;          // sum of bound*volume over all cells
+
+  int index(const int* c) const {
+    return ((c[0]*nCells[1] + c[1])*nCells[2] + c[2])*nCells[3] + c[3];
+  }
+
+public:
+
+  CellEnvelope(const int* n, const double* lo, const double* hi)
+  {
+    total = 1;
+    for(int i=0; i<nDim; i++) {
+      nCells[i] = n[i];
+      xMin[i] = lo[i];
+      xMax[i] = hi[i];
+      width[i] = (hi[i]-lo[i])/n[i];
+      total *= n[i];
+    }
+    bound.assign(total, 0.);
+    integral = 0.;
+  }
+
+  int size() const { return total; }
+  double getIntegral() const { return integral; }
+  double getBound(int cell) const { return bound[cell]; }
+  const vector<double>& getBounds() const { return bound; }
+
+  // bounds of an earlier build() (e.g. from the envelope cache)
+  void loadBounds(const vector<double>& b)
+  {
+    bound = b;
+    buildAlias();
+  }
+
+  // Evaluate f(Q2, W, cosThetaK, phiK) on a lattice with two steps per cell
+  // in every variable and set the bound of each cell to safety times the
+  // largest value on its 3^4 nodes.
+  template <class F>
+  void build(F f, double safety)
+  {
+    int nNodes[nDim];
+    int nTotal = 1;
+    for(int i=0; i<nDim; i++) { nNodes[i] = 2*nCells[i]+1; nTotal *= nNodes[i]; }
+
+    vector<double> node(nTotal);
+    for(int i0=0; i0<nNodes[0]; i0++) {
+      double x0 = getLoopVal(nNodes[0], xMin[0], xMax[0], i0);
+      for(int i1=0; i1<nNodes[1]; i1++) {
+        double x1 = getLoopVal(nNodes[1], xMin[1], xMax[1], i1);
+        for(int i2=0; i2<nNodes[2]; i2++) {
+          double x2 = getLoopVal(nNodes[2], xMin[2], xMax[2], i2);
+          for(int i3=0; i3<nNodes[3]; i3++) {
+            double x3 = getLoopVal(nNodes[3], xMin[3], xMax[3], i3);
+            node[((i0*nNodes[1] + i1)*nNodes[2] + i2)*nNodes[3] + i3] = f(x0, x1, x2, x3);
+          }
+        }
+      }
+    }
+
+    setBounds(node, safety);
+  }
+
+  // bounds from node values on the (2n+1)^4 lattice of build()
+  void setBounds(const vector<double>& node, double safety)
+  {
+    int nNodes[nDim];
+    for(int i=0; i<nDim; i++) nNodes[i] = 2*nCells[i]+1;
+
+    int c[nDim];
+    for(c[0]=0; c[0]<nCells[0]; c[0]++)
+    for(c[1]=0; c[1]<nCells[1]; c[1]++)
+    for(c[2]=0; c[2]<nCells[2]; c[2]++)
+    for(c[3]=0; c[3]<nCells[3]; c[3]++) {
+      double cellMax = 0.;
+      for(int j0=0; j0<3; j0++)
+      for(int j1=0; j1<3; j1++)
+      for(int j2=0; j2<3; j2++)
+      for(int j3=0; j3<3; j3++) {
+        int k = (((2*c[0]+j0)*nNodes[1] + 2*c[1]+j1)*nNodes[2] + 2*c[2]+j2)*nNodes[3] + 2*c[3]+j3;
+        if(node[k] > cellMax) cellMax = node[k];
+      }
+      bound[index(c)] = safety*cellMax;
+    }
+
+    // A cell cut by the kinematic limit can have all its nodes outside
+    // the allowed region. Give such cells the bound of their largest
+    // neighbour in Q2 or W so that no allowed point is unreachable.
+    vector<double> edge(bound);
+    for(c[0]=0; c[0]<nCells[0]; c[0]++)
+    for(c[1]=0; c[1]<nCells[1]; c[1]++)
+    for(c[2]=0; c[2]<nCells[2]; c[2]++)
+    for(c[3]=0; c[3]<nCells[3]; c[3]++) {
+      if(bound[index(c)] > 0.) continue;
+      double neighbourMax = 0.;
+      for(int iDim=0; iDim<2; iDim++) {
+        for(int step=-1; step<=1; step+=2) {
+          int cn[nDim] = {c[0], c[1], c[2], c[3]};
+          cn[iDim] += step;
+          if(cn[iDim] < 0 || cn[iDim] >= nCells[iDim]) continue;
+          if(bound[index(cn)] > neighbourMax) neighbourMax = bound[index(cn)];
+        }
+      }
+      edge[index(c)] = neighbourMax;
+    }
+    bound = edge;
+
+    buildAlias();
+  }
+
+  // Walker alias table for picking a cell with probability bound/sum(bound)
+  // (all cells have the same volume).
+  void buildAlias()
+  {
+    double volume = 1.;
+    for(int i=0; i<nDim; i++) volume *= width[i];
+
+    double sum = 0.;
+    for(int i=0; i<total; i++) sum += bound[i];
+    integral = sum*volume;
+
+    prob.assign(total, 1.);
+    alias.assign(total, 0);
+    if(sum <= 0.) return;
+
+    vector<double> scaled(total);
+    vector<int> small, large;
+    for(int i=0; i<total; i++) {
+      alias[i] = i;
+      scaled[i] = bound[i]*total/sum;
+      if(scaled[i] < 1.) small.push_back(i);
+      else               large.push_back(i);
+    }
+    while(!small.empty() && !large.empty()) {
+      int s = small.back(); small.pop_back();
+      int l = large.back();
+      prob[s] = scaled[s];
+      alias[s] = l;
+      scaled[l] -= 1. - scaled[s];
+      if(scaled[l] < 1.) { large.pop_back(); small.push_back(l); }
+    }
+    // what is left is 1 up to rounding
+    for(size_t i=0; i<large.size(); i++) prob[large[i]] = 1.;
+    for(size_t i=0; i<small.size(); i++) prob[small[i]] = 1.;
+  }
+
+  // pick a cell from two uniform numbers
+  int pickCell(double u1, double u2) const
+  {
+    int i = (int)(u1*total);
+    if(i >= total) i = total-1;
+    return (u2 < prob[i]) ? i : alias[i];
+  }
+
+  // point of the cell from four uniform numbers
+  void pointInCell(int cell, const double* u, double* x) const
+  {
+    int c[nDim];
+    for(int i=nDim-1; i>=0; i--) { c[i] = cell % nCells[i]; cell /= nCells[i]; }
+    for(int i=0; i<nDim; i++) x[i] = xMin[i] + (c[i] + u[i])*width[i];
+  }
+
+};
+
+#endif
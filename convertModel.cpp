@@ -0,0 +1,37 @@
+//SYS LIBRARIES
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "sigmaValera.h"
+
+using namespace std;
+
+// Compile the text tables of every channel into <channel>.model files in
+// the data directory. Sigma maps such a file at start-up instead of
+// parsing the text tables; rerun this after changing any of the tables
+// (a stale model file is detected and ignored).
+//
+// usage: convertModel [dataPath]   (default: $DataKYandOnePion)
+int main(int argc, char *argv[]) {
+
+	string dataPath;
+	if(argc > 1) dataPath = argv[1];
+	else if(getenv("DataKYandOnePion") != NULL) dataPath = getenv("DataKYandOnePion");
+	else {
+		cerr << "ERROR! Set DataKYandOnePion environment variable or give the data path" << endl;
+		return 1;
+	}
+
+	const char* names[4] = {"KLambda", "KSigma", "Pi0P", "PiN"};
+	for(int chanel=1; chanel<=4; chanel++) {
+		Sigma model(dataPath, chanel, false);
+		if(!model.write_model(dataPath)) {
+			cerr << "ERROR! can not write the model of " << names[chanel-1] << endl;
+			return 1;
+		}
+		cout << names[chanel-1] << ": " << Sigma::model_path(dataPath, chanel) << endl;
+	}
+	return 0;
+}
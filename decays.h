@@ -0,0 +1,83 @@
+#ifndef _DECAYS_H
+#define _DECAYS_H
+
+//SYS LIBRARIES
+#include <cmath>
+
+#include "constants.h"
+#include "fourVector.h"
+
+using namespace std;
+
+
+// Two-body decay M -> m1 m2, isotropic in the rest frame of the parent.
+// The energies and the momentum of the daughters in the rest frame depend
+// only on the masses and are computed once per decay mode; decay() then
+// takes a batch of parents and writes the daughters into the caller's
+// arrays, in loops without branches or calls through virtual functions.
+class TwoBodyDecay {
+
+  double E1, E2, p;
+
+public:
+
+  TwoBodyDecay(double M, double m1, double m2) {
+    E1 = (M*M + m1*m1 - m2*m2)/(2.*M);
+    p = sqrt(E1*E1 - m1*m1);
+    E2 = sqrt(m2*m2 + p*p);
+  }
+
+  double getMomentum() const { return p; }
+
+  // n decays of parent[i] (LAB frame). u[2i], u[2i+1] are uniform in (0, 1]
+  // and give the direction of daughter 1 in the rest frame of the parent:
+  // cos(theta) = 2u[2i]-1, phi = 2 pi u[2i+1]; daughter 2 is opposite.
+  // d1[i], d2[i]: the daughters in the LAB frame.
+  void decay(int n, const FourVector *parent, const double *u,
+             FourVector *d1, FourVector *d2) const {
+    for(int i=0; i<n; i++) {
+      double cosTh = -1. + 2.*u[2*i];
+      double sinTh = sqrt(1. - cosTh*cosTh);
+      double phi = 2.*constantPi*u[2*i+1];
+      double nx = sinTh*cos(phi), ny = sinTh*sin(phi), nz = cosTh;
+      FourVector a = {p*nx, p*ny, p*nz, E1};
+      FourVector b = {-p*nx, -p*ny, -p*nz, E2};
+      double bx = parent[i].px/parent[i].E, by = parent[i].py/parent[i].E, bz = parent[i].pz/parent[i].E;
+      a.boost(bx, by, bz);
+      b.boost(bx, by, bz);
+      d1[i] = a;
+      d2[i] = b;
+    }
+  }
+
+};
+
+
+// The decays of the generator. Lambda and Sigma0 have the masses of Rafo's
+// decay code, Lambda(1520) and pi0 those of constants.h.
+const double cTauLambda = 7.89; // cm
+const TwoBodyDecay decayLambda(1.115683, 0.9383, 0.13957039);           // Lambda -> p pi-
+const TwoBodyDecay decaySigma0(1.1925, 1.115683, 0.);                    // Sigma0 -> Lambda gamma
+const TwoBodyDecay decayLambda1520(massLambda1520, massProton, massKaon); // Lambda(1520) -> p K-
+const TwoBodyDecay decayPi0(massPion0, 0., 0.);                          // pi0 -> gamma gamma
+
+
+// Move the vertices vertex[3i..3i+2] of n particles parent[i] with decay
+// length cTau (cm) along the particle to the point where it decays: the
+// flight length is exponential with mean cTau*gamma*beta,
+// -cTau*gamma*beta*log(u[i]) for u[i] uniform in (0, 1].
+void inline moveToDecayVertex(int n, const FourVector *parent, double cTau,
+                              const double *u, double *vertex)
+{
+  for(int i=0; i<n; i++) {
+    double P = parent[i].P();
+    double beta = P/parent[i].E;
+    double gamma = 1./sqrt(1. - beta*beta);
+    double l = -(cTau*gamma*beta)*log(u[i]);
+    vertex[3*i]   += l*parent[i].px/P;
+    vertex[3*i+1] += l*parent[i].py/P;
+    vertex[3*i+2] += l*parent[i].pz/P;
+  }
+}
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef _ENVELOPE_CACHE_H
+#define _ENVELOPE_CACHE_H
+
+//SYS LIBRARIES
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// On-disk cache of the accept-reject envelope (the scalar d5sigmaMax or the
+// per-cell bounds). A cache file is named after a hash of its key and holds
+// the full key, so a hash collision or an old file is never used.
+// The key contains a fingerprint of everything under the data directory:
+// editing any table gives a new key and the old entries are ignored.
+// Files are written to a unique temporary name and renamed into place,
+// which is atomic, so concurrent jobs only ever see complete files.
+class EnvelopeCache {
+
+  string dir;
+  string key;
+  string path;
+
+  static const int version = 1;
+
+  static void fnv1a(uint64_t &h, const char* data, size_t n) {
+    for(size_t i=0; i<n; i++) {
+      h ^= (unsigned char)data[i];
+      h *= 1099511628211ull;
+    }
+  }
+
+  static void listFiles(const string& root, const string& rel, vector<string>& files) {
+    DIR* d = opendir((root + "/" + rel).c_str());
+    if(d == NULL) return;
+    struct dirent* entry;
+    while((entry = readdir(d)) != NULL) {
+      string name = entry->d_name;
+      if(name == "." || name == "..") continue;
+      string relName = rel.empty() ? name : rel + "/" + name;
+      struct stat st;
+      if(stat((root + "/" + relName).c_str(), &st) != 0) continue;
+      if(S_ISDIR(st.st_mode)) listFiles(root, relName, files);
+      else if(S_ISREG(st.st_mode)) {
+        // a cache kept inside the data directory must not change the fingerprint
+        if(relName.size() > 9 && relName.compare(relName.size()-9, 9, ".envcache") == 0) continue;
+        if(relName.find(".envcache.tmp") != string::npos) continue;
+        files.push_back(relName);
+      }
+    }
+    closedir(d);
+  }
+
+public:
+
+  // FNV-1a hash of the names and contents of all files under dataPath
+  static string fingerprint(const string& dataPath) {
+    vector<string> files;
+    listFiles(dataPath, "", files);
+    sort(files.begin(), files.end());
+
+    uint64_t h = 14695981039346656037ull;
+    vector<char> buffer(1 << 16);
+    for(size_t i=0; i<files.size(); i++) {
+      fnv1a(h, files[i].c_str(), files[i].size() + 1);
+      ifstream in((dataPath + "/" + files[i]).c_str(), ios::binary);
+      while(in) {
+        in.read(&buffer[0], buffer.size());
+        fnv1a(h, &buffer[0], in.gcount());
+      }
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)h);
+    return hex;
+  }
+
+  // kind: the start of the file name, other files of the cache (the d5sigma
+  // table) use this one for their names and the fingerprint
+  EnvelopeCache(const string& cacheDir, const string& cacheKey, const string& kind = "envelope")
+    : dir(cacheDir), key(cacheKey)
+  {
+    uint64_t h = 14695981039346656037ull;
+    fnv1a(h, key.c_str(), key.size());
+    char name[64];
+    snprintf(name, sizeof(name), "/%s_%016llx.envcache", kind.c_str(), (unsigned long long)h);
+    path = dir + name;
+  }
+
+  const string& getPath() const { return path; }
+
+  // true if a complete entry with the same key exists
+  bool load(vector<double>& values) const {
+    ifstream in(path.c_str());
+    if(!in.is_open()) return false;
+
+    string magic, fileKey, tail;
+    int fileVersion = 0;
+    size_t n = 0;
+    in >> magic >> fileVersion;
+    getline(in, fileKey);   // rest of the first line
+    getline(in, fileKey);
+    if(magic != "genKYandOnePion-envelope" || fileVersion != version || fileKey != key) return false;
+
+    in >> n;
+    if(!in) return false;
+    vector<double> v(n);
+    for(size_t i=0; i<n; i++) {
+      if(!(in >> v[i])) return false;
+    }
+    in >> tail;
+    if(tail != "end") return false;
+    values = v;
+    return true;
+  }
+
+  // write the entry; a failure only costs the next job a rescan
+  void store(const vector<double>& values) const {
+    mkdir(dir.c_str(), 0775);
+
+    char host[256] = "host";
+    gethostname(host, sizeof(host)-1);
+    ostringstream tmp;
+    tmp << path << ".tmp." << host << "." << getpid();
+
+    FILE* f = fopen(tmp.str().c_str(), "w");
+    if(f == NULL) {
+      cerr << " Warning: can not write envelope cache " << tmp.str() << endl;
+      return;
+    }
+    fprintf(f, "genKYandOnePion-envelope %d\n%s\n%zu\n", version, key.c_str(), values.size());
+    for(size_t i=0; i<values.size(); i++) fprintf(f, "%.17g\n", values[i]);
+    fprintf(f, "end\n");
+    bool ok = (fflush(f) == 0) && (fsync(fileno(f)) == 0);
+    ok = (fclose(f) == 0) && ok;
+    if(!ok || rename(tmp.str().c_str(), path.c_str()) != 0) {
+      cerr << " Warning: can not write envelope cache " << path << endl;
+      remove(tmp.str().c_str());
+    }
+  }
+
+};
+
+#endif
@@ -2,18 +2,19 @@
 #include "string.h"
 #include <time.h>
 
-#include <TLorentzVector.h>
-#include <TRandom.h>
-
+#include "rootCompat.h"
 #include "utils.h"
 #include "constants.h"
 #include "kinematics.h"
+#include "decays.h"
+#include "runStats.h"
 //#include "sigmaKY.h"
 #include "sigmaValera.h"
-#include <TF1.h>
-#include <TMath.h>
-#include <TRandom3.h>
-#include <TRandomGen.h>
+#include "vegasGrid.h"
+#include "cellEnvelope.h"
+#include "envelopeCache.h"
+#include "sigmaTable.h"
+#include <memory>
 #include <sys/time.h>
 
 
@@ -30,6 +31,57 @@ class evGenerator {
   double Wmin;
   double Wmax;
   double d5sigmaMax;
+  // workers for the envelope scan, 0 - all cores
+  int scanThreads;
+  
+  // proposal of (Q2, W, cosThetaK, phiK): "flat", "vegas", "cells" or "phi"
+  string sampling;
+  VegasGrid *grid = 0;
+  CellEnvelope *cells = 0;
+  // accept-reject envelope for d5sigma*jacobian of the proposal
+  double envelope;
+  // the envelope found at the start; the one of the accept-reject step is
+  // raised above a point that overflowed it, until the next setSeed()
+  double baseEnvelope = 0.;
+  bool isRaising = true;
+  static constexpr double overflowMargin = 1.1;
+  // a point above the envelope is kept d5sigma*jacobian/envelope times on
+  // average: the copies still to give and the point
+  int nRepeat = 0;
+  struct Proposal { double Q2, W, cosThetaK, phiK, d5sigma, jacobian, envelope; };
+  Proposal repeated;
+  // volume of the generated (Q2, W, cosThetaK, phiK) box
+  double boxVolume;
+
+  // --tabulate: d5sigma of the event loop from a table of the model, shared
+  // by the copies of the generator (it is not changed after the start)
+  shared_ptr<const SigmaTable> table;
+  static constexpr int nTableNodes[3] = {81, 161, 81};
+  // points of the comparison with the exact model
+  static const int nTableChecks = 100000;
+
+  // weighted mode: every proposal is an event with weight d5sigma/q
+  bool isWeighted;
+  double weight;
+  double density;
+  // kaon (pion) angles in the CM frame of the last event
+  double eventCosThetaK = 0., eventPhiK = 0.;
+
+  // proposals, events and sums of the weights over the run
+  GenStatistics stats;
+  // seconds to read (and tabulate) the model and to find the envelope
+  double loadTime = 0., envelopeTime = 0.;
+
+  // VEGAS warm-up: bins per variable, iterations and calls per iteration
+  static const int vegasBins = 100;
+  static const int vegasIter = 8;
+  static const int vegasCalls = 20000;
+
+  // cells of the binned majorant in Q2, W, cosThetaK, phiK
+  static constexpr int nEnvelopeCells[4] = {10, 32, 10, 4};
+  static constexpr double cellSafety = 1.2;
+  // "phi" uses the same cells in Q2, W, cosThetaK and a single one in phiK
+  static constexpr int nPhiCells[4] = {nEnvelopeCells[0], nEnvelopeCells[1], nEnvelopeCells[2], 1};
   
 
   TRandom* gRandom = new TRandomMT64();
@@ -51,9 +103,15 @@ class evGenerator {
 public:
 
 	// Rafo's Hyper. decay code:
-	TF1 *f_Poisson;
 	TRandom3* rand3 = new TRandom3();
 	//
+
+private:
+  // buffers of decay(), reused from batch to batch
+  vector<double> decayRandom, uSigma, uLambda, uLength, u1520;
+  vector<FourVector> lambda;
+
+public:
 	
 
 
@@ -61,6 +119,8 @@ public:
 evGenerator(string dataPath, string t, double E, 
             double q2min, double q2max,
 	    double wmin,  double wmax, unsigned long long rand_start, bool isL1520_ch, bool isDec,
+	    string samplingMode = "flat", int nScanThreads = 0, string cacheDir = "",
+	    bool weightedMode = false, bool tabulate = false,
 		//double cosmin,  double cosmax,//only for test
 	    double jr=-1, double mr=0, double gr=0, 
             double a12=0., double a32=0., double s12=0., 
@@ -70,6 +130,14 @@ evGenerator(string dataPath, string t, double E,
   isL1520 = isL1520_ch;
   
   isDecay = isDec;
+  sampling = samplingMode;
+  scanThreads = nScanThreads;
+  isWeighted = weightedMode;
+  if(sampling != "flat" && sampling != "vegas" && sampling != "cells" && sampling != "phi") {
+    cerr << " Error! evGenerator::evGenerator Wrong sampling mode " << sampling;
+    cerr << " It must be flat, vegas, cells or phi.";
+    exit(1);
+  }
   
   gRandom->SetSeed(rand_start);
   type = t;
@@ -79,10 +147,11 @@ evGenerator(string dataPath, string t, double E,
   Wmin = wmin;
   Wmax = wmax;
   nEvent = 0;
+  boxVolume = (Q2max-Q2min)*(Wmax-Wmin)*2*0.999999*2*constantPi;
+  weight = 1.;
+  density = 1./boxVolume;
   
   	// Rafo intilization:
-	f_Poisson = new TF1("f_Poisson", "TMath::Poisson(x, [0])", 0., 50.);
-    f_Poisson->SetNpx(1000);
     const std::string sLambdaPID = "3122";
     rand3->SetSeed(rand_start);
 	//
@@ -125,30 +194,372 @@ evGenerator(string dataPath, string t, double E,
   // Initilize: read data file
   //model = new sigmaKY(type);
 
+  double startTime = wallTime();
   model = new Sigma(dataPath,channel);
+  if(tabulate) buildTable(dataPath, cacheDir, channel);
+  loadTime = wallTime() - startTime;
+  startTime = wallTime();
+
+  // The scanned envelopes are kept in the cache (the VEGAS grid is cheap
+  // to train and depends on the seed, it is not cached)
+  EnvelopeCache *cache = 0;
+  if(!cacheDir.empty() && sampling != "vegas") {
+    cache = new EnvelopeCache(cacheDir, envelopeKey(dataPath));
+  }
+  vector<double> cached;
+  bool isCached = (cache != 0) && cache->load(cached);
+  if(isCached) cout << " Envelope is read from the cache " << cache->getPath() << endl;
 
 
+  // Train the importance grid; its weight maximum replaces d5sigmaMax
+  if(sampling == "vegas") {
+    trainGrid();
+  }
+  // Per-cell bounds; the sum of bound*volume is the envelope.
+  // "phi" bounds the phi-averaged cross section and draws phiK exactly.
+  else if(sampling == "cells" || sampling == "phi") {
+    buildCells(isCached ? &cached : 0);
+    if(cache != 0 && !isCached) cache->store(cells->getBounds());
+  }
+  // Weighted events need no maximum with the flat proposal
+  else if(isWeighted) {
+    envelope = 0.;
+  }
   // Find maximum of the cross section
-  if(type == "KLambda" || type == "KSigma" || type == "Pi0P" || type == "PiN") {
+  else if(type == "KLambda" || type == "KSigma" || type == "Pi0P" || type == "PiN") {
     //cout<<"Ebeam=: "<< Ebeam<<" Q2min: "<<Q2min<<" Q2max: "<<Q2max<<" Wmin: "<<Wmin<<" Wmax: "<<Wmax<<endl;
-    d5sigmaMax = model->d5sigma_max(Ebeam, Q2min, Q2max, Wmin, Wmax);
+    if(isCached && cached.size() == 1) d5sigmaMax = cached[0];
+    else {
+      d5sigmaMax = model->d5sigma_max(Ebeam, Q2min, Q2max, Wmin, Wmax, scanThreads);
+      if(cache != 0 && d5sigmaMax > 0) cache->store(vector<double>(1, d5sigmaMax));
+    }
     cout<<" d5sigmaMax: "<<d5sigmaMax<<endl;
 	if(d5sigmaMax==0){
 		cerr << " incorrect kinematic region, pls check input Q2 and Energy";  
 		exit(1);
 	}
+    envelope = d5sigmaMax*boxVolume;
   }
+  delete cache;
+  baseEnvelope = envelope;
+  envelopeTime = wallTime() - startTime;
 	//cout<<"2"<<endl;
   // initialize random seed: 
   srand (time(NULL));
  
 };
 
+// Copy for another thread: own model (Sigma is not thread safe),
+// envelope and random generators. Seed it with setSeed().
+evGenerator(const evGenerator& other)
+  : type(other.type), isDecay(other.isDecay), isL1520(other.isL1520),
+    m1(other.m1), m2(other.m2), Ebeam(other.Ebeam),
+    Q2min(other.Q2min), Q2max(other.Q2max), Wmin(other.Wmin), Wmax(other.Wmax),
+    d5sigmaMax(other.d5sigmaMax), scanThreads(other.scanThreads),
+    sampling(other.sampling), envelope(other.baseEnvelope), baseEnvelope(other.baseEnvelope),
+    isRaising(other.isRaising), boxVolume(other.boxVolume), table(other.table),
+    isWeighted(other.isWeighted), weight(other.weight), density(other.density),
+    nEvent(0)
+{
+  model = new Sigma(*other.model);
+  if(other.grid != 0) grid = new VegasGrid(*other.grid);
+  if(other.cells != 0) cells = new CellEnvelope(*other.cells);
+}
+
+evGenerator& operator=(const evGenerator&) = delete;
+
 ~evGenerator(){
     delete model;
+    delete grid;
+    delete cells;
+    delete gRandom;
+    delete rand3;
 };
 
 
+// Start the independent random streams of the given seed: one for the
+// proposal (and the vertex), one for the hyperon decays. The envelope is
+// set back to the one found at the start and the copies of an overflow
+// point still to come are dropped (see dropRepeats), so a chunk does not
+// depend on the chunks made before it by the same thread.
+void setSeed(unsigned long long seed) {
+  envelope = baseEnvelope;
+  dropRepeats();
+  gRandom->SetSeed(deriveSeed(seed, 0));
+  // TRandom3 takes a 32 bit seed and 0 means "seed from the clock"
+  unsigned int seed3 = (unsigned int)deriveSeed(seed, 1);
+  rand3->SetSeed(seed3 != 0 ? seed3 : 1);
+}
+
+TRandom* getRandom() { return gRandom; }
+
+const GenStatistics& getStatistics() const { return stats; }
+void resetStatistics() { stats = GenStatistics(); }
+void addStatistics(const GenStatistics& other) { stats.add(other); }
+
+// false: an overflow does not raise the envelope (the cocktail draws the
+// channels in proportion to their envelopes), its point is only repeated
+void setEnvelopeRaise(bool isOn) { isRaising = isOn; }
+// true if copies of an overflow point are still to come from tryEvent()
+bool hasRepeat() const { return nRepeat > 0; }
+
+// Drop the copies still to come (a chunk has a fixed number of events).
+// Their envelope is added to the statistics as if they were accepted, so
+// the cross section sumEnvelope/nTrials does not lose them; they are
+// counted in nDropped.
+void dropRepeats() {
+  if(nRepeat <= 0) return;
+  stats.nDropped += nRepeat;
+  stats.sumEnvelope += nRepeat*repeated.envelope;
+  nRepeat = 0;
+}
+// a tighter (f < 1) or looser envelope than the one found at the start
+void scaleEnvelope(double f) { envelope *= f; baseEnvelope *= f; }
+
+
+// Key of the envelope in the cache: everything the scan depends on
+string envelopeKey(const string& dataPath) {
+
+  ostringstream key;
+  key.precision(17);
+  key << "channel=" << type << " ebeam=" << Ebeam
+      << " q2min=" << Q2min << " q2max=" << Q2max
+      << " wmin=" << Wmin << " wmax=" << Wmax
+      << " sampling=" << sampling;
+  if(sampling == "cells" || sampling == "phi") {
+    const int *n = (sampling == "phi") ? nPhiCells : nEnvelopeCells;
+    key << " cells=" << n[0] << "x" << n[1] << "x" << n[2] << "x" << n[3]
+        << " safety=" << cellSafety;
+  }
+  key << " data=" << EnvelopeCache::fingerprint(dataPath);
+  return key.str();
+}
+
+
+// Key of the d5sigma table in the cache
+string tableKey(const string& dataPath) {
+
+  ostringstream key;
+  key.precision(17);
+  key << "channel=" << type << " ebeam=" << Ebeam
+      << " q2min=" << Q2min << " q2max=" << Q2max
+      << " wmin=" << Wmin << " wmax=" << Wmax
+      << " nodes=" << nTableNodes[0] << "x" << nTableNodes[1] << "x" << nTableNodes[2]
+      << " data=" << EnvelopeCache::fingerprint(dataPath);
+  return key.str();
+}
+
+
+// Tabulate the model for the event loop (sigmaTable.h), or read the table
+// of an earlier run from the cache
+void buildTable(const string& dataPath, const string& cacheDir, int channel) {
+
+  SigmaTable *t = new SigmaTable();
+  string key, path;
+  if(!cacheDir.empty()) {
+    key = tableKey(dataPath);
+    path = EnvelopeCache(cacheDir, key, "table").getPath();
+  }
+  if(!path.empty() && t->read(path, key)) {
+    cout << " d5sigma table is read from the cache " << path << endl;
+  } else {
+    double startTime = wallTime();
+    t->build(*model, channel, Ebeam, Q2min, Q2max, Wmin, Wmax, nTableNodes, scanThreads);
+    double where[3] = {0., 0., 0.};
+    t->check(*model, nTableChecks, where);
+    cout << " d5sigma table: " << t->getNodes()[0] << " x " << t->getNodes()[1] << " x " << t->getNodes()[2]
+         << " nodes (" << t->bytes()/1e6 << " MB), made in " << wallTime() - startTime << " s" << endl;
+    cout << " d5sigma table: compared with the model at " << nTableChecks << " points, the largest deviation at Q2 = "
+         << where[0] << ", W = " << where[1] << ", cosThetaK = " << where[2] << endl;
+    if(!path.empty()) {
+      mkdir(cacheDir.c_str(), 0775);
+      t->write(path, key);
+    }
+  }
+  cout << " d5sigma table: largest deviation from the model " << 100.*t->getMaxDeviation()
+       << "% of the largest d5sigma, mean deviation " << 100.*t->getMeanDeviation()
+       << "% of the mean d5sigma" << endl;
+  if(t->getNonFinite() > 0)
+    cout << " Warning: d5sigma table: the table or the model is not finite at " << t->getNonFinite()
+         << " of the " << nTableChecks << " points" << endl;
+  table.reset(t);
+}
+
+
+// d5sigma of the event loop: the table if there is one, else the model
+double eventSigma(double Q2, double W, double cosThetaK, double thetaK, double phiK) {
+  if(table) return table->d5sigma(Q2, W, cosThetaK, phiK);
+  return model->d5sigma(Ebeam, Q2, W, thetaK, phiK);
+}
+
+// the same for the phi harmonics of d5sigma
+void eventHarmonics(double Q2, double W, double cosThetaK, double &a0, double &a1, double &a2, bool &isAbs) {
+  if(!table) {
+    model->d5sigma_harmonics(Ebeam, Q2, W, acos(cosThetaK), a0, a1, a2, isAbs);
+    return;
+  }
+  double f = table->flux(Q2, W);
+  table->harmonics(Q2, W, cosThetaK, a0, a1, a2, isAbs);
+  a0 *= f; a1 *= f; a2 *= f;
+}
+
+
+// Draw (Q2, W, cosThetaK, phiK) from the proposal and return the jacobian
+// 1/q of the proposal density: d5sigma*jacobian is compared with the
+// envelope in the accept-reject step and is the weight of a weighted event.
+// A proposal that evaluates the cross section itself returns it in d5sigma
+// (it is left negative otherwise).
+double propose(double &Q2, double &W, double &cosThetaK, double &phiK, double &d5sigma) {
+
+  // (Q2, W, cosThetaK) from the cells, phiK from the known phi dependence
+  // f = a0 + a1*cos(2phiK) + a2*cos(phiK), |f| where the model takes the abs
+  // and max(f, 0) elsewhere: q = bound/integral * f/<f>, so
+  // d5sigma*jacobian = integral*<f>/bound does not depend on phiK
+  if(sampling == "phi") {
+    double u1 = randomIntv(0., 1.);
+    double u2 = randomIntv(0., 1.);
+    int cell = cells->pickCell(u1, u2);
+    double u[4], x[4];
+    for(int i=0; i<3; i++) u[i] = randomIntv(0., 1.);
+    u[3] = 0.;
+    cells->pointInCell(cell, u, x);
+    Q2 = x[0]; W = x[1]; cosThetaK = x[2];
+    double a0, a1, a2;
+    bool isAbs;
+    eventHarmonics(Q2, W, cosThetaK, a0, a1, a2, isAbs);
+    double mean = harmonicsMean(a0, a1, a2, isAbs);
+    double jacobian3 = cells->getIntegral()/cells->getBound(cell);
+    if(mean <= 0.) {
+      phiK = randomIntv(0.0, 2*constantPi);
+      d5sigma = 0.;
+      return jacobian3;
+    }
+    double fMin, fMax;
+    harmonicsRange(a0, a1, a2, fMin, fMax);
+    double fBound = isAbs ? max(fabs(fMin), fabs(fMax)) : fMax;
+    double f;
+    do {
+      phiK = randomIntv(0.0, 2*constantPi);
+      f = a0 + a1*cos(2*phiK) + a2*cos(phiK);
+      if(isAbs) f = fabs(f);
+    } while(randomIntv(0.,1.)*fBound >= f);
+    d5sigma = f;
+    return jacobian3*mean/f;
+  }
+
+  if(sampling == "vegas") {
+    double u[4], x[4];
+    int bin[4];
+    for(int i=0; i<4; i++) u[i] = randomIntv(0., 1.);
+    double jacobian = grid->map(u, x, bin);
+    Q2 = x[0]; W = x[1]; cosThetaK = x[2]; phiK = x[3];
+    return jacobian;
+  }
+
+  // u*envelope < d5sigma*jacobian reduces to u*bound < d5sigma in the cell
+  if(sampling == "cells") {
+    double u1 = randomIntv(0., 1.);
+    double u2 = randomIntv(0., 1.);
+    int cell = cells->pickCell(u1, u2);
+    double u[4], x[4];
+    for(int i=0; i<4; i++) u[i] = randomIntv(0., 1.);
+    cells->pointInCell(cell, u, x);
+    Q2 = x[0]; W = x[1]; cosThetaK = x[2]; phiK = x[3];
+    return cells->getIntegral()/cells->getBound(cell);
+  }
+
+  Q2 = randomIntv(Q2min, Q2max);
+  W  = randomIntv(Wmin, Wmax);
+  //double cosThetaK=randomIntv(cos_min, cos_max);//only for test
+  cosThetaK = randomIntv(-0.999999,0.999999);//real
+  phiK = randomIntv(0.0, 2*constantPi);
+  return boxVolume;
+}
+
+
+// VEGAS warm-up: adapt the grid to d5sigma, then take the maximum of
+// d5sigma/q over a pass with the frozen grid as the envelope.
+void trainGrid() {
+
+  vector<double> lo = {Q2min, Wmin, -0.999999, 0.};
+  vector<double> hi = {Q2max, Wmax,  0.999999, 2*constantPi};
+  grid = new VegasGrid(vegasBins, lo, hi);
+
+  double u[4], x[4];
+  int bin[4];
+  double wMax = 0., wSum = 0.;
+  for(int iter=0; iter<=vegasIter; iter++) {
+    wMax = 0.;
+    wSum = 0.;
+    for(int i=0; i<vegasCalls; i++) {
+      for(int k=0; k<4; k++) u[k] = randomIntv(0., 1.);
+      double jacobian = grid->map(u, x, bin);
+      double w = jacobian * model->d5sigma(Ebeam, x[0], x[1], acos(x[2]), x[3]);
+      wSum += w;
+      if(w > wMax) wMax = w;
+      if(iter < vegasIter) grid->accumulate(bin, w);
+    }
+    cout << " VEGAS iteration " << iter << ": mean weight " << wSum/vegasCalls
+         << " max weight " << wMax << endl;
+    if(iter < vegasIter) grid->refine(1.5);
+  }
+
+  if(wMax == 0) {
+    cerr << " incorrect kinematic region, pls check input Q2 and Energy";
+    exit(1);
+  }
+  // the maximum over a finite sample underestimates the true one
+  envelope = 1.2*wMax;
+  cout << " VEGAS envelope: " << envelope
+       << " expected acceptance: " << wSum/vegasCalls/envelope << endl;
+}
+
+
+// Binned majorant: bound every cell by the largest d5sigma on its nodes.
+// The safety factor covers the curvature between the nodes.
+// bounds (if given) are the bounds of an earlier run read from the cache.
+// For "phi" the bound is on the phi-averaged cross section (harmonicsMean).
+void buildCells(const vector<double>* bounds) {
+
+  double lo[4] = {Q2min, Wmin, -0.999999, 0.};
+  double hi[4] = {Q2max, Wmax,  0.999999, 2*constantPi};
+  cells = new CellEnvelope(sampling == "phi" ? nPhiCells : nEnvelopeCells, lo, hi);
+
+  if(bounds != 0 && (int)bounds->size() == cells->size()) {
+    cells->loadBounds(*bounds);
+  } else {
+    cout << " Find bounds of the cross section in " << cells->size() << " cells" << endl;
+    Sigma *m = model;
+    double E = Ebeam;
+    if(sampling == "phi") {
+      // the lattice runs over phiK innermost: one harmonics call per node
+      double last[3] = {-1., -1., -2.}, lastValue = 0.;
+      cells->build([m, E, &last, &lastValue](double Q2, double W, double cosThetaK, double /*phiK*/) {
+                     if(Q2 != last[0] || W != last[1] || cosThetaK != last[2]) {
+                       double a0, a1, a2;
+                       bool isAbs;
+                       m->d5sigma_harmonics(E, Q2, W, acos(cosThetaK), a0, a1, a2, isAbs);
+                       lastValue = harmonicsMean(a0, a1, a2, isAbs);
+                       last[0] = Q2; last[1] = W; last[2] = cosThetaK;
+                     }
+                     return lastValue;
+                   }, cellSafety);
+    } else {
+      cells->build([m, E](double Q2, double W, double cosThetaK, double phiK) {
+                     return m->d5sigma(E, Q2, W, acos(cosThetaK), phiK);
+                   }, cellSafety);
+    }
+  }
+
+  envelope = cells->getIntegral();
+  if(envelope == 0) {
+    cerr << " incorrect kinematic region, pls check input Q2 and Energy";
+    exit(1);
+  }
+  cout << " Cell envelope integral: " << envelope << endl;
+}
+
+
 
 
 		 
@@ -156,49 +567,108 @@ evGenerator(string dataPath, string t, double E,
 // all parameters are output parameters
 // 4-momenta of particles in the final state in LAB frame:
 //    Pefin, PK, PL -> electron, Kaon, Lambda/Sigma
-// 4 momenta of 
+// the hyperon decays are made afterwards for a batch of events, see decay()
 
 void getEvent(double &Q2, double &W, 
-              TLorentzVector &Pefin, TLorentzVector &PK, TLorentzVector &PY,
-	      TLorentzVector &Ppfin, TLorentzVector &Ppim, TLorentzVector &Pgam, vector <double>& v_prodIN) 
+              TLorentzVector &Pefin, TLorentzVector &PK, TLorentzVector &PY) 
 										{
 
-  int nTry=0;
   nEvent=0;
-  while(true) {
- 
-    Q2 = randomIntv(Q2min, Q2max);
-    W  = randomIntv(Wmin, Wmax);
+  while(!tryEvent(Q2, W, Pefin, PK, PY)) {}
+
+}; //end getEvent(...)
+
+
+// A single proposal: true if it is accepted and gives an event (same
+// arguments as getEvent), false if it is rejected. The cocktail of several
+// channels calls it directly, with the channel drawn anew for every proposal.
+//
+// A point above the envelope (d5sigma*jacobian > envelope) would be accepted
+// less often than it should. It is kept ratio = d5sigma*jacobian/envelope
+// times on average instead: the next calls give its copies (with their own
+// electron azimuth) before any new proposal. The envelope is then raised
+// to ratio*overflowMargin times itself, the events after it are accepted
+// against the new one; the cross section uses the mean envelope.
+bool tryEvent(double &Q2, double &W, 
+              TLorentzVector &Pefin, TLorentzVector &PK, TLorentzVector &PY) 
+										{
+
+    if(nRepeat > 0) {
+      nRepeat--;
+      const Proposal &p = repeated;
+      Q2 = p.Q2;
+      W = p.W;
+      bool isMade = makeEvent(Q2, W, p.cosThetaK, p.phiK, p.d5sigma, p.jacobian, p.envelope, Pefin, PK, PY);
+      if(isMade) stats.nCopies++;
+      return isMade;
+    }
 
-    //double cosThetaK=randomIntv(cos_min, cos_max);//only for test
-    double cosThetaK = randomIntv(-0.999999,0.999999);//real
+    double cosThetaK, phiK;
+    double d5sigma = -1.;
+    double jacobian = propose(Q2, W, cosThetaK, phiK, d5sigma);
 //cout<<"cosThetaK="<<cosThetaK<<endl;
     double thetaK = acos(cosThetaK);
-    double phiK = randomIntv(0.0, 2*constantPi);
 //cout<<"cosThetaK="<<cosThetaK<<endl;
-    double d5sigma;
-    if(type == "KLambda" || type == "KSigma"|| type == "Pi0P"|| type == "PiN") {
+    if(d5sigma < 0.) {
+      if(type == "KLambda" || type == "KSigma"|| type == "Pi0P"|| type == "PiN") {
 //cout<<"Q2: "<<Q2<<" W: "<<W<<" thetaK: "<< thetaK<<" phiK: "<< phiK<<endl;
-      d5sigma = model->d5sigma(Ebeam, Q2, W, thetaK, phiK);
-    } else {
-      cout <<" ::getEvent " <<  "Wrong reaction type " << type << endl;
+        // reading the clock costs a tenth of a call: every 16th call is timed
+        bool isTimed = (stats.nTrials & 15) == 0;
+        double startTime = isTimed ? wallTime() : 0.;
+        d5sigma = eventSigma(Q2, W, cosThetaK, thetaK, phiK);
+        if(isTimed) stats.d5sigmaTime += 16.*(wallTime() - startTime);
+      } else {
+        cout <<" ::getEvent " <<  "Wrong reaction type " << type << endl;
+      }
     }
         
-    nTry++;
+    stats.nTrials++;
 
 	//if (cos(acos(arg))<0.9) cout<<" ="<<" d5/max= "<<" d5sigma="<<d5sigma<<" d5sigmaMax="<<d5sigmaMax<<" theta: "<<acos(arg)<<" cos: "<<cos(acos(arg))<<endl;
 
-    if(randomIntv(0.,1.) < d5sigma/d5sigmaMax) {
+    // a weighted event is kept unless its weight is zero
+    bool isAccepted;
+    double acceptEnvelope = envelope;
+    if(isWeighted) isAccepted = d5sigma > 0.;
+    else {
+      isAccepted = randomIntv(0.,1.)*envelope < d5sigma*jacobian;
+      if(d5sigma*jacobian > envelope) {
+        double ratio = d5sigma*jacobian/envelope;
+        stats.nOverflows++;
+        stats.maxOverflow = max(stats.maxOverflow, ratio);
+        int nCopies = (int)ratio;
+        if(randomIntv(0.,1.) < ratio - nCopies) nCopies++;
+        nRepeat = nCopies - 1;
+        repeated = {Q2, W, cosThetaK, phiK, d5sigma, jacobian, acceptEnvelope};
+        if(isRaising) envelope *= ratio*overflowMargin;
+      }
+    }
+
+    if(isAccepted) return makeEvent(Q2, W, cosThetaK, phiK, d5sigma, jacobian, acceptEnvelope, Pefin, PK, PY);
+
+    return false;
+
+}; //end tryEvent(...)
 
+
+// The event of an accepted point: the electron (with a random azimuth)
+// and the kaon and hyperon of the CM angles in the LAB frame.
+// env: the envelope the point was accepted with. False for a point
+// outside of the kinematics of the beam.
+bool makeEvent(double Q2, double W, double cosThetaK, double phiK,
+               double d5sigma, double jacobian, double env,
+               TLorentzVector &Pefin, TLorentzVector &PK, TLorentzVector &PY) {
+
+       double startTime = wallTime();
        nEvent++;
 
-       double W2 = W*W;
+       double thetaK = acos(cosThetaK);
        double omega = getomega(Q2,W);
-       if(omega <=0. ) continue;
+       if(omega <=0. ) return false;
        double Ee = Ebeam - omega;
-       if(Ee<massElectron) continue;
+       if(Ee<massElectron) return false;
        double arg = 1. - Q2/(2.*Ebeam*Ee);
-       if( fabs(arg) > 1. ) continue;
+       if( fabs(arg) > 1. ) return false;
        double theta = acos(arg);
        double phi = randomIntv(0.0, 2*constantPi);
        
@@ -206,35 +676,29 @@ void getEvent(double &Q2, double &W,
 
 
        // 4-momentum of final electron in LAB frame
-       Pefin.SetXYZT(1.,1.,1.,Ee);
-       Pefin.SetRho(sqrt(Ee*Ee - massElectron2)); 
-       Pefin.SetTheta(theta);
-       Pefin.SetPhi(phi); 
+       double pe = sqrt(Ee*Ee - massElectron2);
+       double sinTheta = sin(theta);
+       FourVector e = {pe*sinTheta*cos(phi), pe*sinTheta*sin(phi), pe*arg, Ee};
+       Pefin = toLorentz(e);
        
        // 4-momenta of K and Lambda/Sigma //проверить м1 и м2
-       cms2lab(W, Q2, phi, Ebeam, thetaK, phiK, m1, m2, PK, PY);     
+       FourVector K, Y;
+       cms2lab(W, Q2, phi, Ebeam, thetaK, phiK, m1, m2, K, Y);     
+       PK = toLorentz(K);
+       PY = toLorentz(Y);
        
-       
-
 
-       // Decay of Lambda into proton and pi minus. 
-       if(type == "KLambda" && isDecay) {
-	 		//getLdecayProd(PY, Ppfin, Ppim, gRandom);
-	 		DecayLambda(PY, v_prodIN, Ppfin, Ppim, rand3);
-	 	}
-       if(type == "KSigma" && isDecay) {
-       // Decay of Sigma into proton and pi minus and gamma. 
-         TLorentzVector PL;
-         //getSdecayProd(PY, PL, Ppfin, Ppim, Pgam, gRandom);
-         DecaySigma(PY, PL, Pgam, rand3);
-         DecayLambda(PL, v_prodIN, Ppfin, Ppim, rand3);
+       if(isWeighted) {
+         weight = d5sigma*jacobian;
+         density = 1./jacobian;
        }
-       
-       if(type == "KLambda" && isL1520) {
-       // Decay of Sigma into proton and pi minus and gamma. 
-         getL_1520_decayProd(PY, Ppfin, Ppim, gRandom);
-       }
-       
+       else stats.sumEnvelope += env;
+       eventCosThetaK = cosThetaK;
+       eventPhiK = phiK;
+       stats.kinematicsTime += wallTime() - startTime;
+       stats.nAccepted++;
+       stats.sumW += weight;
+       stats.sumW2 += weight*weight;
 
        //cout << " PY " << PY.E() <<" "<< PY.Px() <<" "<< PY.Py() <<" "<< PY.Pz() << endl; 
        //cout << " PS " << (Ppfin+Ppim).E() <<" "<< (Ppfin+Ppim).Px() <<" "<< (Ppfin+Ppim).Py() <<" "<< (Ppfin+Ppim).Pz() << endl; 
@@ -242,14 +706,110 @@ void getEvent(double &Q2, double &W,
        //cout << " Pp " << (Ppfin).E() <<" "<< (Ppfin).Px() <<" "<< (Ppfin).Py() <<" "<< (Ppfin).Pz() << endl; 
        //cout << " Pi " << (Ppim).E()  <<" "<< (Ppim).Px()  <<" "<< (Ppim).Py()  <<" "<< (Ppim).Pz()  << endl; 
        
-       return;
-    
-    }
-
-  
+       return true;
+
+}
+
+
+// true if the hyperons of this channel decay (--decay, Lambda(1520))
+bool hasDecays() const {
+  return ((type == "KLambda" || type == "KSigma") && isDecay) || (type == "KLambda" && isL1520);
+}
+
+// Decays of the hyperons PY[i] of n events of getEvent:
+//   Lambda -> p pi- (Ppfin, Ppim),
+//   Sigma0 -> Lambda gamma (Pgam), then the Lambda -> p pi-,
+//   Lambda(1520) -> p K- (Ppfin, Ppim).
+// vertex[3i..3i+2] is the production vertex of event i, it is moved to the
+// vertex of the Lambda decay. The random numbers are taken from the decay
+// stream event by event, so the result does not depend on the batch size.
+void decay(int n, const FourVector *PY, FourVector *Ppfin, FourVector *Ppim, FourVector *Pgam, double *vertex) {
+  bool isLambda = type == "KLambda" && isDecay;
+  bool isSigma = type == "KSigma" && isDecay;
+  bool is1520 = type == "KLambda" && isL1520;
+  // random numbers of an event: Sigma0 decay (2), Lambda decay (2) and
+  // its flight length (1), Lambda(1520) decay (2)
+  int nSigma = isSigma ? 2 : 0;
+  int nLambda = (isLambda || isSigma) ? 3 : 0;
+  int n1520 = is1520 ? 2 : 0;
+  int nRandom = nSigma + nLambda + n1520;
+  if(n <= 0 || nRandom == 0) return;
+
+  decayRandom.resize(n*nRandom);
+  uSigma.resize(2*n);
+  uLambda.resize(2*n);
+  uLength.resize(n);
+  u1520.resize(2*n);
+  lambda.resize(n);
+  rand3->RndmArray(n*nRandom, &decayRandom[0]);
+  for(int i=0; i<n; i++) {
+    const double *u = &decayRandom[i*nRandom];
+    if(nSigma) { uSigma[2*i] = u[0]; uSigma[2*i+1] = u[1]; u += nSigma; }
+    if(nLambda) { uLambda[2*i] = u[0]; uLambda[2*i+1] = u[1]; uLength[i] = u[2]; u += nLambda; }
+    if(n1520) { u1520[2*i] = u[0]; u1520[2*i+1] = u[1]; }
   }
 
-}; //end getEvent(...)
+  const FourVector *L = PY;
+  if(isSigma) {
+    decaySigma0.decay(n, PY, &uSigma[0], &lambda[0], Pgam);
+    L = &lambda[0];
+  }
+  if(nLambda) {
+    decayLambda.decay(n, L, &uLambda[0], Ppfin, Ppim);
+    moveToDecayVertex(n, L, cTauLambda, &uLength[0], vertex);
+  }
+  if(is1520) decayLambda1520.decay(n, PY, &u1520[0], Ppfin, Ppim);
+}
+
+
+// weight of the last event (1 for unweighted events) and the proposal
+// density q(Q2, W, cosThetaK, phiK) it was drawn with
+double getWeight() const { return weight; }
+double getDensity() const { return density; }
+bool getIsWeighted() const { return isWeighted; }
+double getCosThetaK() const { return eventCosThetaK; }
+double getPhiK() const { return eventPhiK; }
+double getEnvelope() const { return envelope; }
+double getLoadTime() const { return loadTime; }
+// the table of --tabulate (SigmaTable::name), "none" without it
+string getTableName() const { return table ? table->name() : "none"; }
+double getEnvelopeTime() const { return envelopeTime; }
+
+
+// Integral of d5sigma over the generated box: the mean weight per proposal
+// for weighted events, envelope*accepted/trials for unweighted ones.
+void printSummary() const {
+
+  long long nTrials = stats.nTrials, nAccepted = stats.nAccepted;
+  double sumW = stats.sumW, sumW2 = stats.sumW2;
+  if(nTrials == 0) return;
+  cout << endl << " Proposals: " << nTrials << " events: " << nAccepted << endl;
+  if(isWeighted) {
+    double mean = sumW/nTrials;
+    double var = sumW2/nTrials - mean*mean;
+    double err = (var > 0.) ? sqrt(var/nTrials) : 0.;
+    double ess = (sumW2 > 0.) ? sumW*sumW/sumW2 : 0.;
+    cout << " Sum of weights: " << sumW << endl;
+    cout << " Sum of squared weights: " << sumW2 << endl;
+    cout << " Effective sample size: " << ess
+         << " (" << 100.*ess/(nAccepted > 0 ? nAccepted : 1) << "% of the events)" << endl;
+    cout << " Integrated cross section: " << mean << " +- " << err << endl;
+  } else {
+    double p = (double)nAccepted/nTrials;
+    double env = stats.meanEnvelope(envelope);
+    cout << " Acceptance: " << p << endl;
+    cout << " Integrated cross section: " << env*p
+         << " +- " << env*sqrt(p*(1.-p)/nTrials) << endl;
+  }
+  if(stats.nOverflows > 0) {
+    cout << " Envelope overflows: " << stats.nOverflows << " proposals ("
+         << (double)stats.nOverflows/nTrials << " of all), largest d5sigma/envelope "
+         << stats.maxOverflow << ", " << stats.nCopies << " copies of them written to correct them" << endl;
+    if(stats.nDropped > 0)
+      cout << " Copies dropped at the end of a chunk: " << stats.nDropped
+           << " (their envelope is kept in the cross section)" << endl;
+  }
+}
 
 	
 };
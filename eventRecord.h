@@ -0,0 +1,30 @@
+#ifndef _EVENT_RECORD_H
+#define _EVENT_RECORD_H
+
+
+// One generated event as plain numbers, what the library hands to its
+// event sink (generator.h). The particles are those of the lines of the
+// lund file of the channel, in the same order. No ROOT types and no
+// pointers: records can be copied, kept in arrays and passed on to other
+// frameworks as they are.
+struct Particle {
+  int pid;                  // lund (PDG) id
+  double px, py, pz, E;     // GeV, LAB frame
+  double mass;              // as written in the lund file
+  double vx, vy, vz;        // vertex, cm
+};
+
+struct EventRecord {
+  static const int maxParticles = 5;
+
+  int component;            // index of the channel in GeneratorConfig::channels
+  int channel;              // 1 - KLambda, 2 - KSigma, 3 - Pi0P (Pi0P_2g), 4 - PiN
+  double Q2, W, nu;
+  double cosThetaK, phiK;   // kaon (pion) angles in the CM frame
+  double weight, density;   // weighted events: d5sigma/q and q
+  double vx, vy, vz;        // production vertex, cm
+  int nParticles;
+  Particle particles[maxParticles];
+};
+
+#endif
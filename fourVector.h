@@ -0,0 +1,107 @@
+#ifndef _FOUR_VECTOR_H
+#define _FOUR_VECTOR_H
+
+//SYS LIBRARIES
+#include <cmath>
+
+#include "constants.h"
+
+using namespace std;
+
+
+// Four-momentum as four plain doubles: copied with memcpy, kept in arrays,
+// no virtual table, no ROOT. The event kinematics are done with it, ROOT
+// vectors are only made where a TLorentzVector is asked for (kinematics.h).
+struct FourVector {
+
+  double px, py, pz, E;
+
+  double P2() const { return px*px + py*py + pz*pz; }
+  double P() const { return sqrt(P2()); }
+  double M2() const { return E*E - P2(); }
+
+  // boost by the velocity (bx, by, bz), as TLorentzVector::Boost
+  void boost(double bx, double by, double bz) {
+    double b2 = bx*bx + by*by + bz*bz;
+    double gamma = 1./sqrt(1. - b2);
+    double bp = bx*px + by*py + bz*pz;
+    double gamma2 = b2 > 0 ? (gamma - 1.)/b2 : 0.;
+    px += gamma2*bp*bx + gamma*bx*E;
+    py += gamma2*bp*by + gamma*by*E;
+    pz += gamma2*bp*bz + gamma*bz*E;
+    E = gamma*(E + bp);
+  }
+
+};
+
+
+// The hadronic CM frame of an event seen from the LAB frame. In the CM frame
+// Z is along the virtual photon, X in the electron scattering plane and Y
+// perpendicular to it; in the LAB frame Z is along the beam. The CM frame
+// moves along the photon with velocity beta, and ux, uy, uz are its axes in
+// LAB coordinates. Everything follows from (Q2, W, Ebeam) and the azimuth
+// phi of the scattered electron, without Euler angles.
+struct CmsFrame {
+
+  double beta;
+  double ux[3], uy[3], uz[3];
+
+  void set(double W, double Q2, double phi, double Ebeam) {
+    // energy and momentum of the virtual photon in the LAB frame
+    double omega = (W*W + Q2 - massProton2)/(2.*massProton);
+    double q = sqrt(omega*omega + Q2);
+    beta = q/(omega + massProton);
+
+    // polar angle of the photon: Q2 = 2 Ebeam omega' (1 - cos theta_e'),
+    // the photon is opposite to the electron in azimuth
+    double cosG = (Q2 + 2.*Ebeam*omega)/(2.*Ebeam*q);
+    if(cosG > 1.) cosG = 1.;
+    double sinG = sqrt(1. - cosG*cosG);
+    double cosPhi = cos(phi), sinPhi = sin(phi);
+
+    uz[0] = -sinG*cosPhi; uz[1] = -sinG*sinPhi; uz[2] = cosG;
+    uy[0] = -sinPhi;      uy[1] = cosPhi;       uy[2] = 0.;
+    ux[0] = cosG*cosPhi;  ux[1] = cosG*sinPhi;  ux[2] = sinG;
+  }
+
+  // the same frame from the scattered electron Pefin in the LAB frame
+  void set(double Q2, double Ebeam, const FourVector &Pefin) {
+    double omega = Ebeam - Pefin.E;
+    double q[3] = {-Pefin.px, -Pefin.py, Ebeam - Pefin.pz};
+    double qMag = sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2]);
+    beta = sqrt(omega*omega + Q2)/(omega + massProton);
+    for(int i=0; i<3; i++) uz[i] = q[i]/qMag;
+    // uy along photon x electron, ux = uy x uz
+    double y[3] = {q[1]*Pefin.pz - q[2]*Pefin.py, q[2]*Pefin.px - q[0]*Pefin.pz, q[0]*Pefin.py - q[1]*Pefin.px};
+    double yMag = sqrt(y[0]*y[0] + y[1]*y[1] + y[2]*y[2]);
+    for(int i=0; i<3; i++) uy[i] = y[i]/yMag;
+    ux[0] = uy[1]*uz[2] - uy[2]*uz[1];
+    ux[1] = uy[2]*uz[0] - uy[0]*uz[2];
+    ux[2] = uy[0]*uz[1] - uy[1]*uz[0];
+  }
+
+  // a four-momentum of the CM frame in the LAB frame
+  FourVector toLab(FourVector p) const {
+    p.boost(0., 0., beta);
+    FourVector lab;
+    lab.px = p.px*ux[0] + p.py*uy[0] + p.pz*uz[0];
+    lab.py = p.px*ux[1] + p.py*uy[1] + p.pz*uz[1];
+    lab.pz = p.px*ux[2] + p.py*uy[2] + p.pz*uz[2];
+    lab.E = p.E;
+    return lab;
+  }
+
+  // a four-momentum of the LAB frame in the CM frame
+  FourVector toCms(const FourVector &p) const {
+    FourVector cms;
+    cms.px = p.px*ux[0] + p.py*ux[1] + p.pz*ux[2];
+    cms.py = p.px*uy[0] + p.py*uy[1] + p.pz*uy[2];
+    cms.pz = p.px*uz[0] + p.py*uz[1] + p.pz*uz[2];
+    cms.E = p.E;
+    cms.boost(0., 0., -beta);
+    return cms;
+  }
+
+};
+
+#endif
@@ -8,38 +8,94 @@
 #include <cstdlib>
 #include <vector>
 
-//ROOT LIBRARIES
-#include <TLorentzVector.h>
-
-//#include "sigmaKY.h"
-#include "sigmaValera.h"
+#include "rootCompat.h"
 #include "constants.h" 
-#include "kinematics.h"
-#include "evGenerator.h"
+#include "generator.h"
+#include "lundWriter.h"
+#include "runSummary.h"
+#include "outputFile.h"
+#include "rootWriter.h"
+#include "runStats.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <getopt.h>
 
-#include <TRandom3.h>
-#include <TRandomGen.h>
 #include <sys/time.h>
-#include <TF1.h>
 
 #include <chrono>
 #include <ctime> 
+#include <sstream>
+#include <algorithm>
 
 using namespace std;
 
 
+// The events of the library go to the output file: lund text is formatted
+// by the threads of the generator (prepare) and queued for the writer
+// thread of the file, a ROOT file is filled in order by the main thread.
+class FileSink : public EventSink {
 
-int main(int argc, char *argv[]) {
+  const vector<LundWriter*> &writers;
+  OutputFile *output;
+  RootWriter *rootOutput;
+  ProgressMeter &progress;
+  int precision;
+
+public:
+
+  FileSink(const vector<LundWriter*> &w, OutputFile *out, RootWriter *root, ProgressMeter &p, int digits)
+    : writers(w), output(out), rootOutput(root), progress(p), precision(digits) {}
+
+  void prepare(EventBatch &batch) {
+    if (output == 0) return;
+    // at most 6 lines of 8 numbers of precision+8 characters per event
+    batch.data.reserve(batch.events.size()*6*8*(precision + 8));
+    for (size_t i=0; i<batch.events.size(); i++) writers[batch.events[i].component]->write(batch.data, batch.events[i]);
+  }
+
+  bool put(EventBatch &batch) {
+    if (output != 0) output->write(batch.data);
+    else for (size_t i=0; i<batch.events.size(); i++) rootOutput->fill(batch.events[i]);
+    progress.update(batch.first + batch.events.size());
+    if (batch.first % 10000 == 0) cout << " Event # " << batch.first << endl;
+    // the output failed (e.g. the reader of the pipe is gone)
+    return output == 0 || output->good();
+  }
+
+};
 
 
 
-    int channel;
+int main(int argc, char *argv[]) {
+
+    double runStart = wallTime();
+
 	string channelName="KLambda", outputFileName="genKYandOnePion.dat",dataPath;
+	string sampling="flat";
+	int scanThreads=0;
+	string cacheDir="";
+	bool isWeighted = false;
+	int nThreads = 1;
+	// batch production: shard i of N, all shards share the master seed
+	int shard = 0, nShards = 1;
+	bool isShard = false, hasMasterSeed = false, isMerge = false;
+	string summaryFileName="";
+	// cocktail: several channels in one run, e.g. KLambda,KSigma,PiN
+	string channelList="";
+	vector<string> cocktail;
+	// significant digits of the numbers in the output file
+	int precision = 6;
+	// ROOT file output: a TTree, or an RNTuple
+	bool isRNTuple = false;
+	// run report (timings and counters) in JSON, progress line every progressSeconds
+	string reportFileName="";
+	double progressSeconds = 0.;
+	// factor on the accept-reject envelope, < 1 for a tighter one
+	double envelopeScale = 1.;
+	// d5sigma of the event loop from a table of the model
+	bool isTabulated = false;
 	double Ebeam=10.6, Q2min=2., Q2max=12., Wmin=1.05, Wmax=2.7,V_z_min=0.,V_z_max=0.;
 	double target_diameter = 0.;
 	bool isLam1520 = false, isDec = false;
@@ -53,7 +109,7 @@ int main(int argc, char *argv[]) {
     double jr, mr, gr, a12, a32, s12, onlyres;
     
   
-    char* short_options = (char*)"a:b:c:d:e:f:g:h:i:j:k:l:p:r:s:t::";
+    char* short_options = (char*)"a:b:c:d:e:f:g:h:i:j:k:l:p:r:s:t::u:v:w:x::y:z:A:B:CD:E:F::G:H:I:J::";
     const struct option long_options[] = {
         {"channel",required_argument,NULL,'a'},
         {"ebeam",required_argument,NULL,'b'},
@@ -70,12 +126,44 @@ int main(int argc, char *argv[]) {
         {"seed",optional_argument,NULL,'r'},
         {"lambda1520",optional_argument,NULL,'s'},
         {"decay",optional_argument,NULL,'t'},
+        {"sampling",required_argument,NULL,'u'},
+        {"scan_threads",required_argument,NULL,'v'},
+        {"cache_dir",required_argument,NULL,'w'},
+        {"weighted",optional_argument,NULL,'x'},
+        {"threads",required_argument,NULL,'y'},
+        {"shard",required_argument,NULL,'z'},
+        {"master_seed",required_argument,NULL,'A'},
+        {"master-seed",required_argument,NULL,'A'},
+        {"summary",required_argument,NULL,'B'},
+        {"merge",no_argument,NULL,'C'},
+        {"channels",required_argument,NULL,'D'},
+        {"precision",required_argument,NULL,'E'},
+        {"rntuple",optional_argument,NULL,'F'},
+        {"report",required_argument,NULL,'G'},
+        {"progress",required_argument,NULL,'H'},
+        {"envelope_scale",required_argument,NULL,'I'},
+        {"tabulate",optional_argument,NULL,'J'},
         {NULL,0,NULL,0}
     };
 
 		int rez;
 		int option_index;
 		
+		// "--outname -": the events go to stdout and everything that is
+		// printed (here, by ROOT or by printf) to stderr. It is looked for
+		// before the options are read, as reading them prints already.
+		int eventFd = -1;
+		for (int iArg=1; iArg<argc; iArg++) {
+			string arg = argv[iArg];
+			string next = (iArg+1 < argc) ? argv[iArg+1] : "";
+			if (arg == "--outname=-" || arg == "-l-" || ((arg == "--outname" || arg == "-l") && next == "-")) {
+				fflush(stdout);
+				eventFd = dup(1);
+				dup2(2, 1);
+				break;
+			}
+		}
+		
 		cout<<'\n';
 
    while ((rez=getopt_long(argc,argv,short_options,
@@ -232,7 +320,7 @@ int main(int argc, char *argv[]) {
 			
 			case 'r': {
 				if (optarg!=NULL){
-					seed_value=atoi(optarg);
+					seed_value=strtoull(optarg, NULL, 10);
 					cout<<"seed is set to "<<optarg<<endl;
 				}
 				else{
@@ -267,6 +355,164 @@ int main(int argc, char *argv[]) {
 					}
 				break;
 			};
+			case 'u': {
+				if (optarg!=NULL){
+					cout<<"sampling is set to "<<optarg<<endl;
+					sampling=optarg;
+				}
+				else{
+					printf("found sampling without value\n");
+					cout<<"default value (flat) will be used"<<endl;
+					}
+				break;
+			};
+			
+			case 'v': {
+				if (optarg!=NULL){
+					cout<<"scan_threads (workers for the search of the maximum) is set to "<<optarg<<endl;
+					scanThreads=atoi(optarg);
+				}
+				else{
+					printf("found scan_threads without value\n");
+					cout<<"default value (all cores) will be used"<<endl;
+					}
+				break;
+			};
+			
+			case 'w': {
+				if (optarg!=NULL){
+					cout<<"cache_dir (directory of the envelope cache) is set to "<<optarg<<endl;
+					cacheDir=(string)optarg;
+				}
+				else{
+					printf("found cache_dir without value\n");
+					cout<<"the envelope will not be cached"<<endl;
+					}
+				break;
+			};
+			
+			case 'x': {
+				if (optarg==NULL || (string)optarg == "yes"){
+					isWeighted = true;
+					cout<<" weighted events: every proposal is written with its weight"<<endl;
+				}
+				break;
+			};
+			
+			case 'y': {
+				if (optarg!=NULL){
+					cout<<"threads (workers of the event loop) is set to "<<optarg<<endl;
+					nThreads=atoi(optarg);
+				}
+				else{
+					printf("found threads without value\n");
+					cout<<"default value (1) will be used"<<endl;
+					}
+				break;
+			};
+			
+			case 'z': {
+				if (optarg!=NULL && sscanf(optarg, "%d/%d", &shard, &nShards) == 2
+				    && nShards > 0 && shard >= 0 && shard < nShards){
+					cout<<"shard is set to "<<shard<<" of "<<nShards<<endl;
+					isShard = true;
+				}
+				else{
+					cerr<<"ERROR: shard should be i/N with 0 <= i < N"<<endl;
+					return 1;
+					}
+				break;
+			};
+			
+			case 'A': {
+				if (optarg!=NULL){
+					seed_value=strtoull(optarg, NULL, 10);
+					hasMasterSeed = true;
+					cout<<"master seed is set to "<<optarg<<endl;
+				}
+				break;
+			};
+			
+			case 'B': {
+				if (optarg!=NULL){
+					cout<<"summary (run summary file) is set to "<<optarg<<endl;
+					summaryFileName=(string)optarg;
+				}
+				break;
+			};
+			
+			case 'C': {
+				isMerge = true;
+				break;
+			};
+			
+			case 'D': {
+				if (optarg!=NULL){
+					cout<<"channels (cocktail of channels) is set to "<<optarg<<endl;
+					channelList=(string)optarg;
+				}
+				break;
+			};
+			
+			case 'E': {
+				if (optarg!=NULL && atoi(optarg) > 0 && atoi(optarg) <= 17){
+					cout<<"precision (significant digits in the output) is set to "<<optarg<<endl;
+					precision=atoi(optarg);
+				}
+				else{
+					cerr<<"ERROR: precision should be from 1 to 17"<<endl;
+					return 1;
+					}
+				break;
+			};
+			
+			case 'F': {
+				if (optarg==NULL || (string)optarg == "yes"){
+					isRNTuple = true;
+					cout<<" a .root output file gets an RNTuple instead of a TTree"<<endl;
+				}
+				break;
+			};
+			
+			case 'G': {
+				if (optarg!=NULL){
+					cout<<"report (JSON run report) is set to "<<optarg<<endl;
+					reportFileName=(string)optarg;
+				}
+				break;
+			};
+			
+			case 'H': {
+				if (optarg!=NULL && atof(optarg) > 0){
+					cout<<"progress (seconds between progress lines) is set to "<<optarg<<endl;
+					progressSeconds=atof(optarg);
+				}
+				else{
+					cerr<<"ERROR: progress should be a number of seconds > 0"<<endl;
+					return 1;
+					}
+				break;
+			};
+			
+			case 'I': {
+				if (optarg!=NULL && atof(optarg) > 0){
+					cout<<"envelope_scale (factor on the envelope) is set to "<<optarg<<endl;
+					envelopeScale=atof(optarg);
+				}
+				else{
+					cerr<<"ERROR: envelope_scale should be > 0"<<endl;
+					return 1;
+					}
+				break;
+			};
+			
+			case 'J': {
+				if (optarg==NULL || (string)optarg == "yes"){
+					isTabulated = true;
+					cout<<" tabulate: d5sigma of the event loop is interpolated in a table of the model"<<endl;
+				}
+				break;
+			};
 			
 			
 			case '?': default: {
@@ -281,7 +527,99 @@ int main(int argc, char *argv[]) {
   cout<<"\nERROR: Chanel name is wrong. Please use option --channel=KLambda or (KSigma,Pi0P and PiN)\n ";
   return 1;
   }
+  if (channelList != "") {
+    stringstream list(channelList);
+    string name;
+    vector<string> models;
+    while (getline(list, name, ',')) {
+      if (name == "") continue;
+      if (!(name=="KLambda" || name=="KSigma" || name=="Pi0P" || name=="Pi0P_2g" || name=="PiN")) {
+        cout<<"\nERROR: Chanel name "<<name<<" in --channels is wrong. Please use KLambda, KSigma, Pi0P, Pi0P_2g and PiN\n ";
+        return 1;
+      }
+      // Pi0P and Pi0P_2g are the same reaction
+      string model = (name == "Pi0P_2g") ? "Pi0P" : name;
+      if (find(models.begin(), models.end(), model) != models.end()) {
+        cout<<"\nERROR: channel "<<model<<" is given twice in --channels\n ";
+        return 1;
+      }
+      models.push_back(model);
+      cocktail.push_back(name);
+    }
+    if (cocktail.empty()) {
+      cout<<"\nERROR: --channels needs a list of channels, e.g. --channels=KLambda,KSigma,PiN\n ";
+      return 1;
+    }
+    // the run is named after the list, a single channel is an ordinary run
+    channelName = cocktail[0];
+    for (size_t k=1; k<cocktail.size(); k++) channelName += "," + cocktail[k];
+    if (cocktail.size() == 1) cocktail.clear();
+  }
   cout<<'\n'<<"End of option reading\n";
+
+  // merge the summaries of the shards given after the options
+  if (isMerge) {
+    RunSummary merged;
+    vector<int> seen;
+    for (int iArg=optind; iArg<argc; iArg++) {
+      RunSummary part;
+      if (!part.read(argv[iArg])) return 1;
+      if (seen.empty()) {
+        merged = part;
+        merged.trials = merged.accepted = 0;
+        merged.envelope = merged.sumEA = merged.varEA = merged.sumW = merged.sumW2 = 0.;
+        seen.assign(part.nShards, 0);
+      }
+      else if (!merged.isCompatible(part)) {
+        cerr<<"ERROR: "<<argv[iArg]<<" is from another production (settings, events per shard or master seed differ)"<<endl;
+        return 1;
+      }
+      if (part.shard < 0 || part.shard >= (int)seen.size() || seen[part.shard]) {
+        cerr<<"ERROR: "<<argv[iArg]<<": shard "<<part.shard<<" is given twice or out of range"<<endl;
+        return 1;
+      }
+      seen[part.shard] = 1;
+      merged.add(part);
+    }
+    if (seen.empty()) {
+      cerr<<"ERROR: --merge needs the summary files of the shards"<<endl;
+      return 1;
+    }
+    int nFound = 0;
+    for (size_t i=0; i<seen.size(); i++) nFound += seen[i];
+    cout<<" Merged "<<nFound<<" of "<<seen.size()<<" shards"<<endl;
+    if (nFound < (int)seen.size()) {
+      cout<<" Missing shards:";
+      for (size_t i=0; i<seen.size(); i++) if (!seen[i]) cout<<" "<<i;
+      cout<<endl;
+    }
+    merged.shard = -1;
+    merged.firstChunk = 0;
+    merged.print();
+    if (summaryFileName != "" && !merged.write(summaryFileName)) return 1;
+    return 0;
+  }
+
+  // shards must share the seed, otherwise their streams are unrelated
+  if (isShard && !hasMasterSeed) {
+    cerr<<"ERROR: --shard needs --master-seed, the same for all shards"<<endl;
+    return 1;
+  }
+  // the streams come in chunks: shards of whole chunks follow each other
+  // without a gap, so together they are one long run
+  if (isShard && nEventMax % Generator::eventsPerChunk != 0) {
+    cerr<<"ERROR: --shard needs --trig a multiple of "<<Generator::eventsPerChunk<<endl;
+    return 1;
+  }
+  if (isShard && summaryFileName == "") summaryFileName = outputFileName + ".summary";
+  // a .root file gets the events as columns instead of lund text
+  bool isRoot = outputFileName.size() > 5 && outputFileName.compare(outputFileName.size()-5, 5, ".root") == 0;
+  if (isRNTuple && !isRoot) {
+    cerr<<"ERROR: --rntuple needs an output file name ending with .root"<<endl;
+    return 1;
+  }
+  // refuse a format this build can not write before the model is read
+  if (!isRoot && eventFd < 0 && !OutputFile::isSupported(outputFileName)) return 1;
     
     
     
@@ -346,13 +684,9 @@ int main(int argc, char *argv[]) {
 	cout << " Channel is " << channelName << endl;
 	
 	
-	struct timeval tv;
-	gettimeofday(&tv,NULL);
-	unsigned long long rand_start = tv.tv_usec + 1000000ull*tv.tv_sec;
-	gRandom = new TRandomMT64();
-	gRandom->SetSeed(rand_start);
+	// all random streams are derived from this seed
+	unsigned long long rand_start = seed_value;
 	cout << " Random seed: " << rand_start << endl;
-	cout << " Random Engine = " << gRandom->ClassName() << endl;
 	/*
 	long long unsigned max_llint = 0;
 	max_llint = ~max_llint;
@@ -386,270 +720,126 @@ int main(int argc, char *argv[]) {
 		cout<<endl;
 	}
 	
-	bool pion_decay = (channelName == "Pi0P_2g") ? true : false;
-	
-	string channelName_for_test = (channelName == "Pi0P_2g") ? "Pi0P" : channelName;
-	
-	bool check_in_data = check_input_data(dataPath,channelName_for_test,Ebeam,Q2min,Q2max,Wmin,Wmax,nEventMax);
-	if (check_in_data==0) {return 0;}
-
-	// initilize event generator
-	evGenerator eg(dataPath,channelName_for_test, Ebeam,  Q2min, Q2max, Wmin, Wmax, rand_start, isLam1520, isDec);
-	channel=num_chanel(channelName_for_test);
-
-        cout << endl
-	     << " eg_ky initialized for channel " << channelName << endl  
-	     << " Beam energy: " << Ebeam << endl
-	     << " Q2 range: " << Q2min <<"  "<< Q2max << ";  "  
-	     << " W range: "  << Wmin  <<"  "<< Wmax << ";  " << endl
-	     << " Vertex-z range: "  << V_z_min  <<"  "<< V_z_max << ";  " << endl
-	     << "   Number of events " << nEventMax << endl; 
-	     if (channelName_for_test == "KLambda"){
-	     	if(isLam1520) cout << " Lam is Lam(1520), mass: "<< massLambda1520 << endl;
-	     	else cout << " Lambda mass: "<< massLambda << " GeV" << endl;
-	     }
-	     if(isDec) cout <<"decay = yes" << endl;
-	     
- 
-        // 4-momenta of final electron, Kaon and Lambda, proton, pi- in LAB frame
-	TLorentzVector Peini( TVector3(0.,0.,Ebeam), sqrt(Ebeam*Ebeam+0.005*0.005) );
-	TLorentzVector Ppini( TVector3(0.,0.,0.),    0.9383);
-	TLorentzVector Pefin, PK, PL, Ppfin, Ppim, Pgam;
-	double Q2,W;
-	// output  
-	ofstream output(outputFileName.c_str()); 
-	// Loop through events
-        for (int i=0; i<nEventMax; i++) {	
-		
-
-
-
-          // output in lund format
-	  // header
-	  //output << "4 1 1 0 0 0 0 "
-	  
-
-	  
-	  
-	 // V-z calculating:
-	 double vz_for_event=V_z_max;
-	 if ((V_z_max-V_z_min)>0.01){
-	 	vz_for_event=V_z_min + (V_z_max-V_z_min) * 	gRandom->Uniform(0.,1.);
-	 					//(static_cast<double> (rand())/static_cast<double>(RAND_MAX));
-	 }
-	 double vx_event = 0, vy_event = 0;
-	 if (target_diameter > 0.){
-	 	double rad = target_diameter * gRandom->Uniform(0.,1.); 
-	 	//(static_cast<double> (rand())/static_cast<double>(RAND_MAX));
-	 	double angle = constantPi2 * gRandom->Uniform(0.,1.);
-	 	//(static_cast<double> (rand())/static_cast<double>(RAND_MAX));
-	 	vx_event = rad*cos(angle);
-	 	vy_event = rad*sin(angle);
-	 }
-	 vector<double> v_prod = {vx_event, vy_event, vz_for_event};
-	 
-	 // get event. 4-moeg_ky/menta of final state particle. 
-	 // Values of Q2 and W are also returned.  
-     eg.getEvent(Q2, W, Pefin, PK, PL, Ppfin, Ppim, Pgam, v_prod);
-	  
-	 int nParticles = 3;
-	 if (pion_decay && channel==3) nParticles = 4;
-	 if (isDec && channel== 2) nParticles = 5;
-	 if ((isDec || isLam1520) && channel==1) nParticles = 4;
-	 
-	output << nParticles << " 1 1 0 0 0 0 "
-	   <<" "<< W <<" "<< Q2 <<" "<< getomega(Q2, W) 
-		 << endl;
-	  // electron
-	  output 
-	    << "1 -1 1 " << lundIdElectron << " 0 0 "
-	    << Pefin.Px() <<" "<< Pefin.Py() <<" "<< Pefin.Pz() 
-	    <<" "<< Pefin.E() <<" 0.0005"
-	   // <<" 0 0 0 "
-	    << " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-	    << endl;
-	    
-/////////////////////////////////////////////////////////////////////
-/////////////////      KLambda //////////////////////////////////////
-/////////////////////////////////////////////////////////////////////
-
-	if (channel==1){
-	  // Kaon+
-	  output 
-	    << "2 1 1 " << lundIdKaonPlus << " 0 0 "
-	    << PK.Px() <<" "<< PK.Py() <<" "<< PK.Pz() 
-	    <<" "<< PK.E() <<" 0.4936"
-	   // <<" 0 0 0 "
-	    << " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-	    << endl;
-	    
-	    
-	    // No decay L 1.1:
-	    if (!isDec && !isLam1520){
-	    	output 
-			<< "3 0 1 " << lundIdLambda << " 0 0 "
-			<< PL.Px() <<" "<< PL.Py() <<" "<< PL.Pz() 
-			<<" "<< PL.E() <<" " <<  to_string(massLambda).substr(0, 6)
-			<< " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-			<< endl;
-	    }
-	    
-	    
-	    // Decay L 1.1:
-	     if (isDec && !isLam1520){
-	    	output 
-	    	
-	    	<< "3 1 1 " << lundIdProton << " 0 0 "
-		   	<< Ppfin.Px() <<" "<< Ppfin.Py() <<" "<< Ppfin.Pz() 
-		   	<<" "<< Ppfin.E() <<" 0.9383"
-		   	<< " "<<v_prod.at(0)<<" "<<v_prod.at(1)<<" "<<v_prod.at(2)<<" "
-		   	<< endl;
-		   	
-			  output 
-		   	<< "4 -1 1 " << lundIdPiMinus << " 0 0 "
-		   	<< Ppim.Px() <<" "<< Ppim.Py() <<" "<< Ppim.Pz() 
-		   	<<" "<< Ppim.E() <<" 0.1396"
-		   	<< " "<<v_prod.at(0)<<" "<<v_prod.at(1)<<" "<<v_prod.at(2)<<" "
-		   	<< endl;
-
-	    }
-	    
-	    // Decay L 1.520:
-	    if (!isDec && isLam1520){
-	    	output
-	    	<< "3 1 1 " << lundIdProton << " 0 0 "
-		   	<< Ppfin.Px() <<" "<< Ppfin.Py() <<" "<< Ppfin.Pz() 
-		   	<<" "<< Ppfin.E() <<" 0.9383"
-		   	<< " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-		   	<< endl;
-		   	
-			  output 
-		   	<< "4 -1 1 " << lundIdKaonMinus << " 0 0 "
-		   	<< Ppim.Px() <<" "<< Ppim.Py() <<" "<< Ppim.Pz() 
-		   	<<" "<< Ppim.E() << to_string(massKaon).substr(0, 6)
-		   	<< " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-		   	<< endl;
-	    
-	    }
+	// channels of the run: the one of --channel or the cocktail of --channels
+	vector<string> names = cocktail.empty() ? vector<string>(1, channelName) : cocktail;
+	bool isCocktail = names.size() > 1;
+	int nComp = names.size();
+
+	if (nEventMax < 0) {
+	  cout<<"incorrect nEventMax, right value >0 "<< endl;
+	  return 0;
+	}
 
+	GeneratorConfig config;
+	config.channels = names;
+	config.dataPath = dataPath;
+	config.ebeam = Ebeam;
+	config.q2min = Q2min;
+	config.q2max = Q2max;
+	config.wmin = Wmin;
+	config.wmax = Wmax;
+	config.vzMin = V_z_min;
+	config.vzMax = V_z_max;
+	config.targetDiameter = target_diameter;
+	config.lambda1520 = isLam1520;
+	config.decay = isDec;
+	config.weighted = isWeighted;
+	config.sampling = sampling;
+	config.scanThreads = scanThreads;
+	config.cacheDir = cacheDir;
+	config.envelopeScale = envelopeScale;
+	config.tabulate = isTabulated;
+	config.threads = nThreads;
+	config.seed = rand_start;
+	// shard i takes the chunks after those of shards 0..i-1: all shards
+	// together use the streams of one long run with the master seed
+	config.firstChunk = (long long)shard*(nEventMax/Generator::eventsPerChunk);
+
+	Generator gen(config);
+	if (!gen.good()) return 0;
+
+	vector<LundWriter*> writers;
+	for (int k=0; k<nComp; k++) {
+	  bool pion_decay = (names[k] == "Pi0P_2g") ? true : false;
+	  writers.push_back(new LundWriter(gen.channel(k), isDec, isLam1520, pion_decay, isWeighted, isCocktail, precision));
 	}
-/////////////////////////////////////////////////////////////////////
-/////////////////      KSigma  //////////////////////////////////////
-/////////////////////////////////////////////////////////////////////
-	if (channel==2){
-
-	  output 
-	    << "2 1 1 " << lundIdKaonPlus << " 0 0 "
-	    << PK.Px() <<" "<< PK.Py() <<" "<< PK.Pz() 
-	    <<" "<< PK.E() <<" 0.4936"
-	   // <<" 0 0 0 "
-	    << " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-	    << endl;
-	    
-		if (!isDec){
-	  output 
-	    << "3 0 1 " << lundIdSigmaZero << " 0 0 "
-	    << PL.Px() <<" "<< PL.Py() <<" "<< PL.Pz() 
-	    <<" "<< PL.E() <<" 1.192"
-	   // <<" 0 0 0 "
-	    << " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-	    << endl;
-	    } else{
-	    
-	    	  output 
-		   	<< "3 1 1 " << lundIdProton << " 0 0 "
-		   	<< Ppfin.Px() <<" "<< Ppfin.Py() <<" "<< Ppfin.Pz() 
-		   	<<" "<< Ppfin.E() <<" 0.9383"
-		   	<< " "<<v_prod.at(0)<<" "<<v_prod.at(1)<<" "<<v_prod.at(2)<<" "
-		   	<< endl;
-			  output 
-		   	<< "4 -1 1 " << lundIdPiMinus << " 0 0 "
-		   	<< Ppim.Px() <<" "<< Ppim.Py() <<" "<< Ppim.Pz() 
-		   	<<" "<< Ppim.E() <<" 0.1396"
-		   	<< " "<<v_prod.at(0)<<" "<<v_prod.at(1)<<" "<<v_prod.at(2)<<" "
-		   	<< endl;
-			  output 
-		   	<< "5  0 1 " << lundIdGamma << " 0 0 "
-		   	<< Pgam.Px() <<" "<< Pgam.Py() <<" "<< Pgam.Pz() 
-		   	<<" "<< Pgam.E() <<" 0."
-		   	<< " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-		   	<< endl;
-	    }
+
+	// output  
+	// lund text is written (and compressed for .gz and .zst) by a thread of its own
+	OutputFile output;
+	RootWriter rootOutput;
+	if (isRoot ? !rootOutput.open(outputFileName, isRNTuple) : !output.open(outputFileName, eventFd)) return 1;
+	ProgressMeter progress(nEventMax, progressSeconds);
+	FileSink sink(writers, isRoot ? 0 : &output, isRoot ? &rootOutput : 0, progress, precision);
+	double loopStart = wallTime();
+	gen.generate(nEventMax, sink);
+	double closeStart = wallTime();
+	if (!(isRoot ? rootOutput.close() : output.close())) return 1;
+
+	RunReport report;
+	gen.fillReport(report);
+	report.outputTime = isRoot ? wallTime() - closeStart : output.getWriteTime();
+	report.loopWall = wallTime() - loopStart;
+	
+	// counters of the whole run; the weights are added as they are written
+	GenStatistics all = gen.statistics();
+	for (int k=0; k<nComp; k++) {
+	  if (isCocktail) cout << endl << " Channel " << names[k] << ":";
+	  gen.printSummary(k);
 	}
 
-	if (channel==3){
-		if (pion_decay){
-		
-			TLorentzVector gamma1, gamma2;
-            getPi0decayProd(PK, gamma1, gamma2, gRandom);
-		
-		output 
-	    << "2 0 1 " << 22 << " 0 0 "
-	    << gamma1.Px() <<" "<< gamma1.Py() <<" "<< gamma1.Pz() 
-	    <<" "<< gamma1.E() <<" 0.0"
-			  << " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-	    << endl;
-	    
-	  output 
-	    << "3 0 1 " << 22 << " 0 0 "
-	    << gamma2.Px() <<" "<< gamma2.Py() <<" "<< gamma2.Pz() 
-	    <<" "<< gamma2.E() <<" 0.0"
-			  << " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-	    << endl;
-	    
-	  output 
-	    << "4 1 1 " << lundIdProton << " 0 0 "
-	    << PL.Px() <<" "<< PL.Py() <<" "<< PL.Pz() 
-	    <<" "<< PL.E() <<" 0.9382"
-			  << " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-	    << endl;
-		
-		}else{
-			output 
-			  << "2 0 1 " << lundIdPiZero << " 0 0 "
-			  << PK.Px() <<" "<< PK.Py() <<" "<< PK.Pz() 
-			  <<" "<< PK.E() <<" 0.134"
-			 // <<" 0 0 0 "
-			  << " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-			  << endl;
-			  
-			 output 
-			  << "3 1 1 " << lundIdProton << " 0 0 "
-			  << PL.Px() <<" "<< PL.Py() <<" "<< PL.Pz() 
-			  <<" "<< PL.E() <<" 0.9382"
-			 // <<" 0 0 0 "
-			  << " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-			  << endl;
-		}
+	RunSummary summary;
+	summary.channel = channelName;
+	summary.ebeam = Ebeam;
+	summary.q2min = Q2min;
+	summary.q2max = Q2max;
+	summary.wmin = Wmin;
+	summary.wmax = Wmax;
+	summary.sampling = sampling;
+	summary.weighted = isWeighted ? 1 : 0;
+	summary.decay = isDec ? 1 : 0;
+	summary.lambda1520 = isLam1520 ? 1 : 0;
+	summary.envelopeScale = envelopeScale;
+	summary.tabulate = isTabulated ? 1 : 0;
+	summary.table = gen.tableName();
+	summary.masterSeed = rand_start;
+	summary.shard = shard;
+	summary.nShards = nShards;
+	summary.events = nEventMax;
+	summary.firstChunk = config.firstChunk;
+	// the copies of overflow points dropped at the end of a chunk count as
+	// accepted (in a single channel their envelope is in meanEnvelope)
+	double cocktailEnvelope = gen.envelope()*(all.nAccepted + all.nDropped)/max(all.nAccepted, 1LL);
+	summary.setCounts(all.nTrials, all.nAccepted, isCocktail ? cocktailEnvelope : gen.statistics(0).meanEnvelope(gen.envelope()), all.sumW, all.sumW2);
+
+	// share of every channel in the events and in the cross section
+	if (isCocktail) {
+	  cout << endl << " Cocktail:" << endl;
+	  summary.print();
+	  for (int k=0; k<nComp; k++) {
+	    const GenStatistics &total = gen.statistics(k);
+	    RunSummary part = summary;
+	    part.setCounts(total.nTrials, total.nAccepted, total.meanEnvelope(gen.envelope(k)), total.sumW, total.sumW2);
+	    cout << "   " << names[k] << ": " << total.nAccepted << " events ("
+	         << 100.*total.nAccepted/max(all.nAccepted, 1LL) << "%), cross section "
+	         << part.crossSection() << " +- " << part.crossSectionError() << endl;
+	  }
 	}
 
-	if (channel==4){
-
-	  output 
-	    << "2 1 1 " << lundIdPiPlus << " 0 0 "
-	    << PK.Px() <<" "<< PK.Py() <<" "<< PK.Pz() 
-	    <<" "<< PK.E() <<" 0.1395"
-	   // <<" 0 0 0 "
-	    << " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-	    << endl;
-
-	  output 
-	    << "3 0 1 " << lundIdNeutron << " 0 0 "
-	    << PL.Px() <<" "<< PL.Py() <<" "<< PL.Pz() 
-	    <<" "<< PL.E() <<" 0.939"
-	   // <<" 0 0 0 "
-	    << " "<<vx_event<<" "<<vy_event<<" "<<vz_for_event<<" "
-	    << endl;
+	if (summaryFileName != "") {
+	  if (!summary.write(summaryFileName)) return 1;
+	  cout << " Run summary is written to " << summaryFileName << endl;
 	}
 
-  
-	  
-	  if( i % 10000 == 0) {
-	    cout << " Event # " << i << endl; 
-	  }
+	// where the time went: the stages of the event loop are summed over the threads
+	report.wall = wallTime() - runStart;
+	report.print();
+	if (reportFileName != "") {
+	  if (!report.write(reportFileName)) return 1;
+	  cout << " Run report is written to " << reportFileName << endl;
 	}
-	output.close();
-	
+
+	for (int k=0; k<nComp; k++) delete writers[k];
 
 	return 0;
 	
@@ -0,0 +1,379 @@
+//SYS LIBRARIES
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#ifndef GENKY_NO_ROOT
+//ROOT LIBRARIES
+#include <TROOT.h>
+#endif
+
+#include "generator.h"
+#include "rootCompat.h"
+#include "sigmaValera.h"
+#include "constants.h"
+#include "kinematics.h"
+#include "decays.h"
+#include "evGenerator.h"
+#include "lundWriter.h"
+
+using namespace std;
+
+
+// A finished chunk: the events for the sink, the counters per channel and
+// the seconds in the decays and in prepare() of the sink
+struct Generator::Chunk {
+  EventBatch batch;
+  vector<GenStatistics> stats;
+  double decayTime = 0.;
+  double formatTime = 0.;
+};
+
+
+Generator::Generator(const GeneratorConfig &c) : config(c) {
+
+  nComp = config.channels.size();
+  isCocktail = nComp > 1;
+  pion_decay.resize(nComp);
+  channels.resize(nComp);
+  for (int k=0; k<nComp; k++) {
+    pion_decay[k] = (config.channels[k] == "Pi0P_2g") ? true : false;
+    string channelName = pion_decay[k] ? "Pi0P" : config.channels[k];
+
+    if (!check_input_data(config.dataPath, channelName, config.ebeam, config.q2min, config.q2max,
+                          config.wmin, config.wmax, 0)) return;
+
+    // initilize event generator
+    gens.push_back(new evGenerator(config.dataPath, channelName, config.ebeam, config.q2min, config.q2max,
+                                   config.wmin, config.wmax, config.seed, config.lambda1520, config.decay,
+                                   config.sampling, config.scanThreads, config.cacheDir, config.weighted,
+                                   config.tabulate));
+    channels[k] = num_chanel(channelName);
+    // the channels of a cocktail are drawn in proportion to their envelopes,
+    // which must stay as they are: overflow points are only repeated
+    if (isCocktail) gens.back()->setEnvelopeRaise(false);
+    if (config.envelopeScale != 1.) gens.back()->scaleEnvelope(config.envelopeScale);
+
+    cout << endl
+         << " eg_ky initialized for channel " << config.channels[k] << endl
+         << " Beam energy: " << config.ebeam << endl
+         << " Q2 range: " << config.q2min << "  " << config.q2max << ";  "
+         << " W range: " << config.wmin << "  " << config.wmax << ";  " << endl
+         << " Vertex-z range: " << config.vzMin << "  " << config.vzMax << ";  " << endl;
+    if (channelName == "KLambda") {
+      if (config.lambda1520) cout << " Lam is Lam(1520), mass: " << massLambda1520 << endl;
+      else cout << " Lambda mass: " << massLambda << " GeV" << endl;
+    }
+    if (config.decay) cout << "decay = yes" << endl;
+
+    layouts.push_back(new LundWriter(channels[k], config.decay, config.lambda1520, pion_decay[k],
+                                     config.weighted, isCocktail));
+  }
+
+  // The cocktail draws the channel of every proposal with probability
+  // envelope/(sum of the envelopes) and makes the accept-reject step of that
+  // channel, so the channels come out in proportion to their integrated
+  // cross sections. Weighted events are divided by the probability of their
+  // channel; without envelopes (flat weighted proposal) all are equally likely.
+  envelopes.resize(nComp);
+  mixProb.assign(nComp, 1./nComp);
+  mixCumul.resize(nComp);
+  bool hasEnvelopes = true;
+  for (int k=0; k<nComp; k++) {
+    envelopes[k] = gens[k]->getEnvelope();
+    envelopeSum += envelopes[k];
+    if (envelopes[k] <= 0.) hasEnvelopes = false;
+  }
+  for (int k=0; k<nComp; k++) {
+    if (hasEnvelopes) mixProb[k] = envelopes[k]/envelopeSum;
+    mixCumul[k] = (k > 0 ? mixCumul[k-1] : 0.) + mixProb[k];
+  }
+  if (isCocktail) {
+    cout << endl << " Cocktail of " << nComp << " channels, probability per proposal:" << endl;
+    for (int k=0; k<nComp; k++) cout << "   " << config.channels[k] << ": " << mixProb[k] << endl;
+  }
+
+  total.resize(nComp);
+  isValid = true;
+}
+
+
+Generator::~Generator() {
+  for (size_t k=0; k<gens.size(); k++) delete gens[k];
+  for (size_t k=0; k<layouts.size(); k++) delete layouts[k];
+}
+
+
+// nEvents events of chunk iChunk (of the whole run) with the generators g
+// of all channels
+void Generator::makeChunk(vector<evGenerator*> &g, long long iChunk, int nEvents, Chunk &chunk, EventSink &sink) {
+
+  unsigned long long chunkSeed = deriveSeed(config.seed, config.firstChunk + iChunk);
+  // the cocktail draws the channels and the vertex from a stream of its own
+  TRandomMT64 mixer;
+  TRandom *rnd = &mixer;
+  if (isCocktail) {
+    mixer.SetSeed(deriveSeed(chunkSeed, 2));
+    for (int k=0; k<nComp; k++) g[k]->setSeed(deriveSeed(chunkSeed, 3+k));
+  } else {
+    g[0]->setSeed(chunkSeed);
+    rnd = g[0]->getRandom();
+  }
+  for (int k=0; k<nComp; k++) g[k]->resetStatistics();
+  // hyperons (pi0) of a channel, their decay products and vertices
+  vector<FourVector> parent(nEvents), daughter1(nEvents), daughter2(nEvents), photon(nEvents);
+  vector<double> vertex(3*nEvents), uPi0(2*nEvents);
+  vector<Event> events(nEvents);
+  vector<int> component(nEvents);
+  double V_z_min = config.vzMin, V_z_max = config.vzMax;
+  double target_diameter = config.targetDiameter;
+  for (int i=0; i<nEvents; i++) {
+    Event &ev = events[i];
+
+    // V-z calculating:
+    ev.vz = V_z_max;
+    if ((V_z_max-V_z_min)>0.01){
+      ev.vz = V_z_min + (V_z_max-V_z_min) * rnd->Uniform(0.,1.);
+    }
+    ev.vx = 0;
+    ev.vy = 0;
+    if (target_diameter > 0.){
+      double rad = target_diameter * rnd->Uniform(0.,1.);
+      double angle = constantPi2 * rnd->Uniform(0.,1.);
+      ev.vx = rad*cos(angle);
+      ev.vy = rad*sin(angle);
+    }
+    ev.v_prod = {ev.vx, ev.vy, ev.vz};
+
+    // get event. 4-momenta of final state particle.
+    // Values of Q2 and W are also returned.
+    int k = 0;
+    if (isCocktail) {
+      // the copies of an overflow point come first
+      for (k=0; k<nComp && !g[k]->hasRepeat(); k++) {}
+      bool isRepeat = k < nComp && g[k]->tryEvent(ev.Q2, ev.W, ev.Pefin, ev.PK, ev.PL);
+      if (!isRepeat) do {
+        double u = rnd->Uniform(0.,1.);
+        for (k=0; k+1<nComp && u >= mixCumul[k]; k++) {}
+      } while (!g[k]->tryEvent(ev.Q2, ev.W, ev.Pefin, ev.PK, ev.PL));
+    }
+    else g[0]->getEvent(ev.Q2, ev.W, ev.Pefin, ev.PK, ev.PL);
+    ev.weight = g[k]->getWeight()/mixProb[k];
+    ev.density = g[k]->getDensity()*mixProb[k];
+    ev.cosThetaK = g[k]->getCosThetaK();
+    ev.phiK = g[k]->getPhiK();
+    component[i] = k;
+  }
+  // the chunk is full: copies of an overflow point still to come are
+  // dropped, their envelope stays in the cross section
+  for (int k=0; k<nComp; k++) g[k]->dropRepeats();
+
+  // decays of the chunk, channel by channel
+  double startTime = wallTime();
+  for (int k=0; k<nComp; k++) {
+    bool isPi0 = pion_decay[k] && channels[k]==3;
+    if (!g[k]->hasDecays() && !isPi0) continue;
+    int n = 0;
+    for (int i=0; i<nEvents; i++) {
+      if (component[i] != k) continue;
+      parent[n] = toFourVector(isPi0 ? events[i].PK : events[i].PL);
+      for (int j=0; j<3; j++) vertex[3*n+j] = events[i].v_prod[j];
+      n++;
+    }
+    if (isPi0) {
+      rnd->RndmArray(2*n, &uPi0[0]);
+      decayPi0.decay(n, &parent[0], &uPi0[0], &daughter1[0], &daughter2[0]);
+    }
+    else g[k]->decay(n, &parent[0], &daughter1[0], &daughter2[0], &photon[0], &vertex[0]);
+    n = 0;
+    for (int i=0; i<nEvents; i++) {
+      if (component[i] != k) continue;
+      Event &ev = events[i];
+      if (isPi0) {
+        ev.gamma1 = toLorentz(daughter1[n]);
+        ev.gamma2 = toLorentz(daughter2[n]);
+      }
+      else {
+        ev.Ppfin = toLorentz(daughter1[n]);
+        ev.Ppim = toLorentz(daughter2[n]);
+        if (channels[k]==2) ev.Pgam = toLorentz(photon[n]);
+        for (int j=0; j<3; j++) ev.v_prod[j] = vertex[3*n+j];
+      }
+      n++;
+    }
+  }
+  chunk.decayTime = wallTime() - startTime;
+
+  // the particles of the events as the lund file has them
+  chunk.batch.events.resize(nEvents);
+  for (int i=0; i<nEvents; i++) layouts[component[i]]->fillRecord(events[i], component[i], chunk.batch.events[i]);
+
+  startTime = wallTime();
+  sink.prepare(chunk.batch);
+  chunk.formatTime = wallTime() - startTime;
+
+  chunk.stats.resize(nComp);
+  for (int k=0; k<nComp; k++) chunk.stats[k] = g[k]->getStatistics();
+}
+
+
+bool Generator::generate(long long n, EventSink &sink) {
+
+  if (!isValid) return false;
+  long long nChunks = (n + eventsPerChunk - 1)/eventsPerChunk;
+  long long firstChunk = nextChunk, firstEvent = nGenerated;
+  nextChunk += nChunks;
+  nGenerated += max(n, 0LL);
+
+  auto startChunk = [&](long long iChunk, Chunk &chunk) {
+    chunk.batch.first = firstEvent + iChunk*eventsPerChunk;
+    return (int)min((long long)eventsPerChunk, n - iChunk*eventsPerChunk);
+  };
+  auto putChunk = [&](Chunk &chunk) {
+    double startTime = wallTime();
+    bool ok = sink.put(chunk.batch);
+    putTime += wallTime() - startTime;
+    decayTime += chunk.decayTime;
+    formatTime += chunk.formatTime;
+    for (int k=0; k<nComp; k++) total[k].add(chunk.stats[k]);
+    return ok;
+  };
+
+  bool ok = true;
+  int nThreads = config.threads;
+  if (nThreads <= 1) {
+    for (long long iChunk=0; iChunk<nChunks; iChunk++) {
+      Chunk chunk;
+      int nEvents = startChunk(iChunk, chunk);
+      makeChunk(gens, firstChunk + iChunk, nEvents, chunk, sink);
+      // the sink stops the run (e.g. the reader of the pipe is gone)
+      if (!putChunk(chunk)) {
+        ok = false;
+        break;
+      }
+    }
+    return ok;
+  }
+
+#ifndef GENKY_NO_ROOT
+  ROOT::EnableThreadSafety();
+#endif
+  cout << " Event loop: " << nThreads << " threads" << endl;
+
+  // every thread has its own copy of the generators
+  vector< vector<evGenerator*> > copies(nThreads);
+  for (int t=0; t<nThreads; t++)
+    for (int k=0; k<nComp; k++) copies[t].push_back(new evGenerator(*gens[k]));
+
+  // finished chunks wait here until all earlier ones are given to the
+  // sink; workers stay at most a few chunks per thread ahead of it
+  mutex chunkMutex;
+  condition_variable chunkCond;
+  map<long long, Chunk> done;
+  long long nextFree = 0, nWritten = 0;
+  const int maxAhead = 4*nThreads;
+
+  auto worker = [&](int t) {
+    while (true) {
+      long long iChunk;
+      {
+        unique_lock<mutex> lock(chunkMutex);
+        chunkCond.wait(lock, [&]{ return nextFree >= nChunks || nextFree < nWritten + maxAhead; });
+        if (nextFree >= nChunks) return;
+        iChunk = nextFree++;
+      }
+      Chunk chunk;
+      int nEvents = startChunk(iChunk, chunk);
+      makeChunk(copies[t], firstChunk + iChunk, nEvents, chunk, sink);
+      {
+        lock_guard<mutex> lock(chunkMutex);
+        done[iChunk] = std::move(chunk);
+      }
+      chunkCond.notify_all();
+    }
+  };
+
+  vector<thread> workers;
+  for (int t=0; t<nThreads; t++) workers.push_back(thread(worker, t));
+
+  for (long long iChunk=0; iChunk<nChunks; iChunk++) {
+    Chunk chunk;
+    {
+      unique_lock<mutex> lock(chunkMutex);
+      chunkCond.wait(lock, [&]{ return done.count(iChunk) > 0; });
+      chunk = std::move(done[iChunk]);
+      done.erase(iChunk);
+      nWritten = iChunk+1;
+    }
+    chunkCond.notify_all();
+    // the sink stops the run: no new chunks
+    if (!putChunk(chunk)) {
+      ok = false;
+      {
+        lock_guard<mutex> lock(chunkMutex);
+        nextFree = nChunks;
+      }
+      chunkCond.notify_all();
+      break;
+    }
+  }
+
+  for (size_t t=0; t<workers.size(); t++) workers[t].join();
+  for (size_t t=0; t<copies.size(); t++)
+    for (size_t k=0; k<copies[t].size(); k++) delete copies[t][k];
+  return ok;
+}
+
+
+GenStatistics Generator::statistics() const {
+  GenStatistics all;
+  for (int k=0; k<nComp; k++) {
+    GenStatistics scaled = total[k];
+    scaled.sumW /= mixProb[k];
+    scaled.sumW2 /= mixProb[k]*mixProb[k];
+    all.add(scaled);
+  }
+  return all;
+}
+
+
+string Generator::tableName() const {
+  return gens[0]->getTableName();
+}
+
+
+void Generator::printSummary(int k) {
+  gens[k]->resetStatistics();
+  gens[k]->addStatistics(total[k]);
+  gens[k]->printSummary();
+}
+
+
+void Generator::fillReport(RunReport &report) const {
+  report.threads = config.threads;
+  report.events = statistics().nAccepted;
+  report.channels.clear();
+  for (int k=0; k<nComp; k++) {
+    RunReport::Channel c;
+    c.name = config.channels[k];
+    c.trials = total[k].nTrials;
+    c.accepted = total[k].nAccepted;
+    c.loadTime = gens[k]->getLoadTime();
+    c.envelopeTime = gens[k]->getEnvelopeTime();
+    c.d5sigmaTime = total[k].d5sigmaTime;
+    c.kinematicsTime = total[k].kinematicsTime;
+    c.overflows = total[k].nOverflows;
+    c.maxOverflow = total[k].maxOverflow;
+    c.copies = total[k].nCopies;
+    c.dropped = total[k].nDropped;
+    report.channels.push_back(c);
+  }
+  report.decayTime = decayTime;
+  report.formatTime = formatTime;
+  report.outputWait = putTime;
+}
@@ -0,0 +1,150 @@
+#ifndef _GENERATOR_H
+#define _GENERATOR_H
+
+//SYS LIBRARIES
+#include <string>
+#include <vector>
+
+#include "eventRecord.h"
+#include "runStats.h"
+
+using namespace std;
+
+class evGenerator;
+class LundWriter;
+
+
+// The generator as a library (libgenKYandOnePion): make a Generator from
+// a GeneratorConfig and let generate() hand the events to an EventSink,
+// in memory, without a lund file in between. genKYandOnePion is a client
+// of it that writes the events to lund or ROOT files.
+//
+//   GeneratorConfig config;
+//   config.channels = {"KSigma"};
+//   config.dataPath = getenv("DataKYandOnePion");
+//   config.seed = 7;
+//   Generator gen(config);
+//   if(gen.good()) gen.generate(100000, mySink);
+//
+// The constructor checks the configuration (check_input_data) and
+// prepares the model and the envelope of every channel.
+
+
+struct GeneratorConfig {
+  // "KLambda", "KSigma", "Pi0P", "Pi0P_2g", "PiN"; several channels are a
+  // cocktail, the channel of every event is drawn in proportion to its
+  // integrated cross section
+  vector<string> channels = {"KLambda"};
+  string dataPath;                 // the data directory
+  double ebeam = 10.6;             // GeV
+  double q2min = 2., q2max = 12.;  // GeV2
+  double wmin = 1.05, wmax = 2.7;  // GeV
+  double vzMin = 0., vzMax = 0.;   // vertex z range, cm
+  double targetDiameter = 0.;      // cm, 0: the vertex is on the beam line
+  bool lambda1520 = false;         // KLambda with Lambda(1520) -> p K-
+  bool decay = false;              // hyperon decays
+  bool weighted = false;           // every proposal is an event with a weight
+  string sampling = "flat";        // "flat", "vegas", "cells" or "phi"
+  int scanThreads = 0;             // threads of the envelope scan, 0 - all cores
+  string cacheDir;                 // cache of the envelopes, "" - none
+  double envelopeScale = 1.;       // factor on the envelopes
+  bool tabulate = false;           // d5sigma from a table of the model (sigmaTable.h)
+  int threads = 1;                 // threads of the event loop
+  unsigned long long seed = 0;     // all random streams are derived from it
+  long long firstChunk = 0;        // the random streams start at this chunk (shards)
+};
+
+
+// The events of a chunk, in the order they were generated. first: number
+// of the first one in the run. data is the sink's: prepare() may format
+// the events into it, put() then writes it out.
+struct EventBatch {
+  long long first = 0;
+  vector<EventRecord> events;
+  string data;
+};
+
+
+// Receives the events of generate(). prepare() is called by the thread
+// that made the batch, for the batches in any order and from several
+// threads at once; put() by the thread of generate(), for the batches in
+// order. put() returns false to stop the run (e.g. the output failed).
+class EventSink {
+public:
+  virtual ~EventSink() {}
+  virtual void prepare(EventBatch &/*batch*/) {}
+  virtual bool put(EventBatch &batch) = 0;
+};
+
+
+class Generator {
+
+  GeneratorConfig config;
+  bool isValid = false;
+  bool isCocktail = false;
+  int nComp = 0;
+
+  // per channel: the generator, the particles of its events, the lund
+  // channel number and if the pi0 decays
+  vector<evGenerator*> gens;
+  vector<LundWriter*> layouts;
+  vector<int> channels;
+  vector<bool> pion_decay;
+
+  // envelope of every channel, its probability per proposal and the
+  // cumulative sum of these
+  vector<double> envelopes, mixProb, mixCumul;
+  double envelopeSum = 0.;
+
+  // chunks and events made by the earlier calls of generate(): the next
+  // ones take the random streams after theirs
+  long long nextChunk = 0, nGenerated = 0;
+  vector<GenStatistics> total;
+  double decayTime = 0., formatTime = 0., putTime = 0.;
+
+  struct Chunk;
+  void makeChunk(vector<evGenerator*> &g, long long iChunk, int nEvents, Chunk &chunk, EventSink &sink);
+
+public:
+
+  static const int eventsPerChunk = 1000;
+
+  explicit Generator(const GeneratorConfig &c);
+  ~Generator();
+  Generator(const Generator&) = delete;
+  Generator& operator=(const Generator&) = delete;
+
+  // false if the configuration was refused (the reason is printed)
+  bool good() const { return isValid; }
+
+  // n events, given to the sink in chunks of eventsPerChunk. Events are
+  // made in chunks with their own random streams, so they do not depend
+  // on the number of threads. False if the sink stopped the run.
+  bool generate(long long n, EventSink &sink);
+
+  int components() const { return nComp; }
+  const string& channelName(int k) const { return config.channels[k]; }
+  int channel(int k) const { return channels[k]; }
+  double probability(int k) const { return mixProb[k]; }
+  double envelope(int k) const { return envelopes[k]; }
+  // sum of the envelopes of all channels
+  double envelope() const { return envelopeSum; }
+  // the d5sigma table of --tabulate (the same grid for all channels),
+  // "none" without it
+  string tableName() const;
+
+  // counters of all generate() calls: of channel k, and of the run with
+  // the weights of the cocktail (divided by the probability of the channel)
+  const GenStatistics& statistics(int k) const { return total[k]; }
+  GenStatistics statistics() const;
+
+  // the cross section of channel k (and the weights, the overflows)
+  void printSummary(int k);
+
+  // the counters, the time of every channel and of the decays, the
+  // formatting (prepare) and put() of the sink
+  void fillReport(RunReport &report) const;
+
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef _GRID_INTERP_H
+#define _GRID_INTERP_H
+
+//SYS LIBRARIES
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+// Index of a table given row by row on a rectilinear grid in N variables,
+// e.g. the low Q2 tables: (Q2, W, cosThetaK) -> (p0, p1, p2).
+// The rows are sorted on the first variable, the rows with the same first
+// k values form a block and inside a block they are sorted on variable k.
+// The nodes may differ from block to block (every Q2 has its own W), so
+// for every block the index keeps the distinct values of its variable and
+// the row where each of them starts. It is built once after reading and
+// every lookup is a search over the nodes of one block: a direct index if
+// the nodes of the block are equidistant, a binary search otherwise.
+template <int N, class Payload>
+class RectilinearGrid {
+
+  vector<double> keys[N];       // value of every variable in every row
+  vector<Payload> payload;      // what is interpolated, one per row
+
+  // nodes of all blocks of a level, block after block
+  vector<double> nodeKey[N];
+  vector<int>    nodeRow[N];    // first row of the node = its block at level+1
+  // per row: the nodes of the block starting at that row (-1 if none)
+  vector<int>    blockBegin[N];
+  vector<int>    blockEnd[N];
+  vector<double> blockStep[N];  // node spacing of equidistant blocks, 0 if not
+
+  void indexBlock(int level, int first, int last)
+  {
+    blockBegin[level][first] = nodeKey[level].size();
+    int i = first;
+    while(i < last) {
+      int j = i+1;
+      while(j < last && keys[level][j] == keys[level][i]) j++;
+      if((int)nodeKey[level].size() > blockBegin[level][first] && nodeKey[level].back() >= keys[level][i]) {
+        cerr << " Error! table is not sorted in variable " << level << " at row " << i << endl;
+        exit(1);
+      }
+      nodeKey[level].push_back(keys[level][i]);
+      nodeRow[level].push_back(i);
+      i = j;
+    }
+    blockEnd[level][first] = nodeKey[level].size();
+
+    // equidistant nodes (up to a quarter of the spacing) get a direct index
+    int nNodes = blockEnd[level][first] - blockBegin[level][first];
+    double step = 0.;
+    if(nNodes > 1) {
+      const double* k = &nodeKey[level][blockBegin[level][first]];
+      step = (k[nNodes-1]-k[0])/(nNodes-1);
+      for(int n=0; n<nNodes; n++)
+        if(abs(k[n] - (k[0] + n*step)) > 0.25*step) step = 0.;
+    }
+    blockStep[level][first] = step;
+
+    if(level+1 < N) {
+      for(int n = blockBegin[level][first]; n < blockEnd[level][first]; n++) {
+        int next = (n+1 < blockEnd[level][first]) ? nodeRow[level][n+1] : last;
+        indexBlock(level+1, nodeRow[level][n], next);
+      }
+    }
+  }
+
+public:
+
+  void clear()
+  {
+    for(int l=0; l<N; l++) {
+      keys[l].clear(); nodeKey[l].clear(); nodeRow[l].clear();
+      blockBegin[l].clear(); blockEnd[l].clear(); blockStep[l].clear();
+    }
+    payload.clear();
+  }
+
+  void addRow(const double* x, const Payload& p)
+  {
+    for(int l=0; l<N; l++) keys[l].push_back(x[l]);
+    payload.push_back(p);
+  }
+
+  // index the rows added so far
+  void build()
+  {
+    int nRows = payload.size();
+    for(int l=0; l<N; l++) {
+      nodeKey[l].clear(); nodeRow[l].clear();
+      blockBegin[l].assign(nRows, -1);
+      blockEnd[l].assign(nRows, -1);
+      blockStep[l].assign(nRows, 0.);
+    }
+    if(nRows > 0) indexBlock(0, 0, nRows);
+  }
+
+  int rows() const { return payload.size(); }
+  const Payload& at(int row) const { return payload[row]; }
+  double key(int level, int row) const { return keys[level][row]; }
+
+  // nodes of the block of `level` that starts at row `block`
+  // (the whole table is the only block of level 0, it starts at row 0)
+  int firstNode(int level, int block) const { return blockBegin[level][block]; }
+  int lastNode(int level, int block) const { return blockEnd[level][block]-1; }
+  double node(int level, int n) const { return nodeKey[level][n]; }
+  int row(int level, int n) const { return nodeRow[level][n]; }
+
+  // Find x among the nodes of a block, as a scan over the nodes would:
+  // the first node that matches x (x == node, or |x-node| < tol if tol > 0)
+  // or that is followed by a node with node < x < next.
+  // Returns 1 and n1 = n2 = the matching node, 2 and the nodes n1, n2 = n1+1
+  // around x, or 0 if x is outside the block.
+  int locate(int level, int block, double x, double tol, int &n1, int &n2) const
+  {
+    int first = blockBegin[level][block];
+    int last  = blockEnd[level][block];
+    if(first < 0 || first == last) return 0;
+
+    // nodes followed by one below x-tol can not match, skip them
+    // (2*tol leaves a margin for rounding)
+    const double* k = &nodeKey[level][0];
+    double xSkip = x-2.*tol;
+    int n;
+    double step = blockStep[level][block];
+    if(step > 0.) {
+      // bin of an equidistant grid, then correct it for the rounding
+      double bin = (xSkip - k[first])/step;
+      if(!(bin > 0.)) n = first;
+      else if(bin >= last-first-1) n = last-1;
+      else n = first + (int)bin;
+      while(n > first && k[n-1] >= xSkip) n--;
+      while(n < last && k[n] < xSkip) n++;
+    }
+    else n = lower_bound(k+first, k+last, xSkip) - k;
+    if(n > first) n--;
+
+    for(; n < last; n++) {
+      bool match = (tol > 0.) ? (abs(x-k[n]) < tol) : (x == k[n]);
+      if(match) { n1 = n2 = n; return 1; }
+      if(n+1 < last && x > k[n] && x < k[n+1]) { n1 = n; n2 = n+1; return 2; }
+      if(k[n] > x+tol) break;
+    }
+    return 0;
+  }
+
+};
+
+#endif
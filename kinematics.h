@@ -11,10 +11,11 @@
 #include <cmath>
 #include <cstdlib>
 
-//ROOT LIBRARIES
-#include <TLorentzVector.h>
+#include "rootCompat.h"
 
 #include "constants.h"
+#include "fourVector.h"
+#include "decays.h"
 
 using namespace std;
 
@@ -40,17 +41,17 @@ double inline getomegastar(double Q2, double W)
 
 
 
-double getKH(double Q2, double W) {
+double inline getKH(double Q2, double W) {
    return getomega(Q2, W) - (Q2/2./massProton);
 }
 
-double getK(double Q2, double W){
+double inline getK(double Q2, double W){
 	return (2*getomega(Q2,W)*massProton-Q2)/(2*massProton);
 }
 
 
 // longitudinal polarization parameter
-double getEpsilon(double Ebeam, double Q2, double W)
+double inline getEpsilon(double Ebeam, double Q2, double W)
 {
   double omega = getomega(Q2, W);  
   return 1./
@@ -59,7 +60,7 @@ double getEpsilon(double Ebeam, double Q2, double W)
 }  
 
 // 
-double getEpsilonL(double Ebeam, double Q2, double W)
+double inline getEpsilonL(double Ebeam, double Q2, double W)
 {
   double omega =  getomega(Q2, W);
   double eps = getEpsilon(Ebeam, Q2, W);
@@ -86,7 +87,7 @@ double getEpsilonL(double Ebeam, double Q2, double W)
 
 
 // calculate virtual photon flux (Gamma)
-double getGamma(double Ebeam, double Q2, double W)
+double inline getGamma(double Ebeam, double Q2, double W)
 {
   double mp=massProton;
   double mp2 = massProton2;
@@ -107,266 +108,124 @@ double getGamma(double Ebeam, double Q2, double W)
 
 
 
+// ROOT vectors of FourVector and back, for the callers that need them
+TLorentzVector inline toLorentz(const FourVector &p)
+{
+  return TLorentzVector(p.px, p.py, p.pz, p.E);
+}
+
+FourVector inline toFourVector(const TLorentzVector &p)
+{
+  FourVector v = {p.Px(), p.Py(), p.Pz(), p.E()};
+  return v;
+}
+
+
 // calculate 4-momenta of Kaon (PK) and Lambda in LAB frame
 // from:  
 // W, Q2,  Phi of electron in LAB frame, Ebeam.
 // thetaK, phiK are angles of Kaon in CM frame, 
 // mK, mL are masses of Kaon and Lambda
 // output is PK and PL
-void cms2lab(double W, double Q2, double phi, double Ebeam, 
+void inline cms2lab(double W, double Q2, double phi, double Ebeam, 
 	     double thetaK, double phiK, double mK, double mL,
-	     TLorentzVector &PK, TLorentzVector &PL) 
+	     FourVector &PK, FourVector &PL) 
 {
-
-  double mp=massProton;
-  double pi=constantPi;
-  double mp2 = massProton2;
-  double W2 = W*W;
-  double thetaL = pi-thetaK;
-  double phiL = phiK+pi; if(phiL>2.*pi) phiL=phiL-2.*pi;
-
-  //Energy of virtual photon is LAB frame
-  double Egamma_lab = (W2 + Q2 - mp2)/(2.*mp);
-  //Energy of virtual photon is CMS-frame
-  double Egamma_cms = (W2 - Q2 - mp2)/(2.*W);
-
-   //4-momenta of virt. photon and proton in  in CMS
-  TLorentzVector Pgamma_cms,Peini_cms,Pp_cms;
-  double PgammaZ_cms = sqrt(Egamma_cms*Egamma_cms+Q2);
-  Pgamma_cms.SetXYZT(0,0,PgammaZ_cms,Egamma_cms); 
-  Pp_cms.SetXYZT(0,0,PgammaZ_cms,sqrt(mp2+PgammaZ_cms*PgammaZ_cms));
-
-  //4-momenta of K and L in CMS. Set energy components 
-  PK.SetXYZT(1.,1.,1.,(W*W+mK*mK-mL*mL)/2./W);
-  PL.SetXYZT(1.,1.,1.,(W*W+mL*mL-mK*mK)/2./W);
-  //Set momentum muduli and angles
-  PK.SetRho(sqrt(PK.E()*PK.E()-mK*mK));
-  PL.SetRho(sqrt(PL.E()*PL.E()-mL*mL));
-  PK.SetTheta(thetaK);
-  PK.SetPhi(phiK);
-  PL.SetTheta(thetaL);
-  PL.SetPhi(phiL);
-  PK.Boost(0,0,sqrt(Egamma_lab*Egamma_lab+Q2)/(Egamma_lab+mp));
-  PL.Boost(0,0,sqrt(Egamma_lab*Egamma_lab+Q2)/(Egamma_lab+mp));
-  // Now we are in the LAB-frame (let's mark it frame 2) with 
-  // Z2 - along the virtual photon, X2 - in the ee'-PLane and 
-  // Y2 - perpendicular to the e'-PLane.
-  // The only thing left is to rotate our coordinate axes into usual 
-  // LAB-frame-axes-orientation (lets call it frame 1): 
-  // Z1-axis along the beam, 
-  // Y1 - up, X1 - to the south.
-  // For that purpose we will find coordinates of unit vectors along 
-  // the axes of frame 2 in frame 1.
-  TVector3 Pefin,Pgamma,PX,PY; 
-  // We define 3-vector of scattered electron in LAB-frame 1 
-  // theta is from the formula for Q2 in the LAB frame: 
-  // Q2 = 2 E_beam E_e' (1-cos(theta_e'))
-  Pefin.SetXYZ(0.,0.,1.);
-  Pefin.SetTheta(acos( 1. - Q2/(2.*Ebeam*(Ebeam-Egamma_lab))) );
-  Pefin.SetPhi(phi); 
-
-  // 3-vector of virtual photon in LAB-frame
-  Pgamma.SetXYZ(0.,0.,1.);
-  Pgamma.SetTheta(acos( (Q2+2.*Ebeam*Egamma_lab)
-                        /(2.*Ebeam*(sqrt(Q2+Egamma_lab*Egamma_lab))) ) );
-  if (phi < pi)  Pgamma.SetPhi(phi + pi);
-  else           Pgamma.SetPhi(phi - pi);
-  //Pgamma is along Z2 and now it is written in the frame 1
-
-  // PY is along Y2 (perpendicular to the scattering PLane)
-  PY = (Pgamma.Cross(Pefin)).Unit();
-  // PX is along X2 (in scattering PLane)
-  PX = (PY.Cross(Pgamma)).Unit();
-
-  // Now unit vectors of frame 2 are written in the frame 1. 
-  // We define rotation of frame 2 -> frame 1 via the Euler Angles  	   
-  TRotation vrot;
-  vrot.SetXEulerAngles(atan2(PX.Z(),PY.Z()), acos(Pgamma.Z()), 
-                       atan2(Pgamma.X(),-1.*Pgamma.Y()));
-  	   
-  // transfom our 4-momenta of final hadrons according to axes transformation
-  PK.Transform(vrot);
-  PL.Transform(vrot);
-
-  return;
+  // 4-momenta of K and L in CMS: back to back, energies from W and the masses
+  double EK = (W*W+mK*mK-mL*mL)/2./W;
+  double EL = (W*W+mL*mL-mK*mK)/2./W;
+  double p = sqrt(EK*EK-mK*mK);
+  double sinThetaK = sin(thetaK);
+  double nx = sinThetaK*cos(phiK), ny = sinThetaK*sin(phiK), nz = cos(thetaK);
+  FourVector K = {p*nx, p*ny, p*nz, EK};
+  FourVector L = {-p*nx, -p*ny, -p*nz, EL};
+
+  // boost along the virtual photon and turn the axes to the LAB ones
+  // (Z along the beam), see CmsFrame
+  CmsFrame frame;
+  frame.set(W, Q2, phi, Ebeam);
+  PK = frame.toLab(K);
+  PL = frame.toLab(L);
 } //end cms2lab(...)
 
-void getPi0decayProd(TLorentzVector &PL,
-                    TLorentzVector &Ppfin, TLorentzVector &Ppim, TRandom* gRandom) {
-
-   //4-momenta Ppfin and Ppim in PL rest frame
-   //Set energy components
-   //double mL=massPion0;
-   Ppfin.SetXYZT(1.,1.,1.,(massPion0*massPion0)/2./massPion0);
-   Ppim.SetXYZT (1.,1.,1.,(massPion0*massPion0)/2./massPion0);
-   
-   //Set momentum muduli and angles
-   Ppfin.SetRho(sqrt(Ppfin.E()*Ppfin.E()));
-   Ppim.SetRho (sqrt(Ppim.E()*Ppim.E()));
-   double cost      = randomIntvTR(-1., 1., gRandom);
-   double thetapfin = acos(cost);
-   double phipfin   = randomIntvTR(0.0, 2.*constantPi, gRandom);
-   double thetapim = constantPi-thetapfin;
-   double phipim   = phipfin+constantPi; if(phipim>2.*constantPi) phipim=phipim-2.*constantPi;
-   Ppfin.SetTheta(thetapfin);
-   Ppfin.SetPhi(phipfin);
-   Ppim.SetTheta(thetapim);
-   Ppim.SetPhi(phipim);
-   
-        //cout << " SSSS " <<  Ppfin.E() + Ppim.E() << " " << endl;
-	//cout << " EECMS " <<  Ppfin.E() << " " <<  Ppim.E() << " " << endl;
-	//cout << " PPCMS " <<  Ppfin.Vect().Mag() << " " <<  Ppim.Vect().Mag() << " " << endl;
-	//cout << " MMCMS " <<  Ppfin.M() << " " <<  Ppim.Mag() << " " << endl;
-	 
-	 
-   // boost to the PL lab frame.
-   double vx = PL.Px()/PL.E();
-   double vy = PL.Py()/PL.E();
-   double vz = PL.Pz()/PL.E();
-   Ppfin.Boost(vx,vy,vz);
-   Ppim.Boost (vx,vy,vz);
-	//cout << " PPLAB " <<  Ppfin.Vect().Mag() << " " <<  Ppim.Vect().Mag() << " " << endl;
-
- 	//cout << " PPLAB " <<  Ppfin.Vect().Z() << " " <<  Ppim.Vect().Z() << " " << endl;
-  
-
-
-   //Ppfin.SetXYZT(0.1,0.1,0.1,(massPion0*massPion0)/2./massPion0);
-   //Ppim.SetXYZT (0.1,0.1,0.1,(massPion0*massPion0)/2./massPion0);
-   //Ppfin.Boost(vx,vy,vz);
-   //Ppim.Boost (vx,vy,vz);
- 
-   //cout << " PPBOOST " <<  Ppfin.Vect().Mag() << " " <<  Ppim.Vect().Mag() << " " << endl;
+void inline cms2lab(double W, double Q2, double phi, double Ebeam, 
+	     double thetaK, double phiK, double mK, double mL,
+	     TLorentzVector &PK, TLorentzVector &PL) 
+{
+  FourVector K, L;
+  cms2lab(W, Q2, phi, Ebeam, thetaK, phiK, mK, mL, K, L);
+  PK = toLorentz(K);
+  PL = toLorentz(L);
+}
 
+// pi0 (PL) -> 2 gamma (Ppfin, Ppim), one event; see decayPi0 for batches
+void inline getPi0decayProd(TLorentzVector &PL,
+                    TLorentzVector &Ppfin, TLorentzVector &Ppim, TRandom* gRandom) {
+   double u[2];
+   u[0] = gRandom->Rndm();
+   u[1] = gRandom->Rndm();
+   FourVector parent = toFourVector(PL), g1, g2;
+   decayPi0.decay(1, &parent, u, &g1, &g2);
+   Ppfin = toLorentz(g1);
+   Ppim = toLorentz(g2);
 }
 
 
 // calculate Theta and Phi of the Kaon in hadron CM frame
 // from:  
-// Q2, Ebeam and 4-momenta of electon (Pefin), Kaon (PK), and Lambda (PL)
-// in LAB frame
-void lab2cms(double Q2, double Ebeam, 
-     TLorentzVector Pefin, TLorentzVector PK, TLorentzVector PL, 
+// Q2, Ebeam and 4-momenta of electon (Pefin) and Kaon (PK) in LAB frame
+// (the frame follows from the electron alone, the hyperon is not needed)
+void inline lab2cms(double Q2, double Ebeam, 
+     const FourVector &Pefin, const FourVector &PK, 
      double &theta_hadr, double &phi_hadr)
 {
+  CmsFrame frame;
+  frame.set(Q2, Ebeam, Pefin);
+  FourVector K = frame.toCms(PK);
 
-  
-  double mp=massProton;
-
-  double a_gamma, b_gamma, a_beta,b_beta, beta;
-  TVector3 Vect3_gamma, Vect3_beta, V3_anti_z(0,0,-1);
-  TLorentzVector Peini, Pgamma; 
-  TRotation rot; 
- 
-  Peini.SetXYZT(0.,0.,Ebeam, Ebeam);
-
-  Pgamma = Peini - Pefin;
-
-  TVector3 uz = Pgamma.Vect().Unit();
-  TVector3 ux = (Peini.Vect().Cross(Pefin.Vect())).Unit();
-  ux.Rotate(3.*constantPi/2,uz);
-  rot.SetZAxis(uz,ux).Invert();
-  PK.Transform(rot);
-  PL.Transform(rot);
-  Pgamma.Transform(rot);
-
-  beta = sqrt(Pgamma.E()*Pgamma.E()+Q2)/(Pgamma.E()+mp);
- 
-  PK.Boost(0.,0.,-beta);
-  PL.Boost(0.,0.,-beta);
-  Pgamma.Boost(0.,0.,-beta);
-
-  theta_hadr = PK.Theta();
-
-  if (PK.Phi()>0) phi_hadr = PK.Phi();
-  else            phi_hadr = PK.Phi()+2.*constantPi;
-
-  return;
- 
- };
-
-
-// Rafo's L decay:
-void DecayLambda(TLorentzVector &L_Lambda, vector <double>& v_prod, TLorentzVector &L_prot, TLorentzVector & L_pim, TRandom3* rand3){
-
-    const double M_Lambda = 1.115683; // mass in GeV
-    const double cTau = 7.89; // cm
-
-    const double Mp = 0.9383;
-    const double Mpi = 0.13957039;
-
-    // proton energy in CM frame
-    double Ep = (M_Lambda * M_Lambda - Mpi * Mpi + Mp * Mp) / (2 * M_Lambda); // pdg eq (47.16)
-
-    double p = sqrt(Ep * Ep - Mp * Mp); // momentum of particles in Lambda CM
-
-    double Epi = sqrt(Mpi * Mpi + p * p); // Pion Energy
-
-    
-    // ========= decaying izotropically ===================
-    double cosTh = rand3->Uniform(-1., 1.);
-    double sinTh = sqrt(1. - cosTh * cosTh);
-    double phi = rand3->Uniform(0., 2 * TMath::Pi());
-
-    // ============= Setting proton 4 vector
-    L_prot.SetPxPyPzE(p * sinTh * cos(phi), p * sinTh * sin(phi), p*cosTh, Ep);
-    // ==== Bringing to the Lab frame
-    L_prot.Boost(L_Lambda.BoostVector());
-    // ============= Setting pim 4 vector
-    L_pim.SetPxPyPzE(-p * sinTh * cos(phi), -p * sinTh * sin(phi), -p*cosTh, Epi);
-    // ==== Bringing to the Lab frame
-    L_pim.Boost(L_Lambda.BoostVector());
-
-    // ====== distance traveled 
-    //double l = rand3->PoissonD(cTau*L_Lambda.Gamma() );
-    //f_Poisson->SetParameter(0, cTau*L_Lambda.Gamma());
-    //double l = f_Poisson->GetRandom(0., 45);
-    double l = rand3->Exp(cTau*L_Lambda.Gamma()*L_Lambda.Beta());
-
-    // ====== New positions x(y,z) = prod_positrion_X(y,z) = l*PX(Y,Z)_Lambda/P_Lambda
-    //vector<double> vert;
-    v_prod.at(0) = (v_prod.at(0) + l * L_Lambda.Px() / L_Lambda.P());
-    v_prod.at(1) = (v_prod.at(1) + l * L_Lambda.Py() / L_Lambda.P());
-    v_prod.at(2) = (v_prod.at(2) + l * L_Lambda.Pz() / L_Lambda.P());
-
-   // cout<<" ====================== Inside the Function =================== "<<endl;
-  //  cout<<"=== 4 Momenta = ("<<L_Lambda.Px()<<","<<L_Lambda.Py()<<","<<L_Lambda.Pz()<<","<<L_Lambda.E()<<")"<<endl;
-  //  cout<<"===== V_Prot = ("<<v_prod.at(0)<<","<<v_prod.at(1)<<","<<v_prod.at(2)<<")"<<endl;
-  //  cout<<"==== V_Decay = ("<<vert.at(0)<<","<<vert.at(1)<<","<<vert.at(2)<<")"<<endl;
-  //  cout<<" ==== GAMMA = "<<L_Lambda.Gamma()<<endl;
-  //  cout<<" ==== l = "<<l<<endl;
-    
+  theta_hadr = atan2(sqrt(K.px*K.px + K.py*K.py), K.pz);
+  phi_hadr = atan2(K.py, K.px);
+  if (phi_hadr<=0) phi_hadr = phi_hadr+2.*constantPi;
 }
 
-void DecaySigma(TLorentzVector &L_Sigma, TLorentzVector &L_Lambda, TLorentzVector &L_gamma, TRandom3* rand3) {
-    const double M_Sigma = 1.1925; // mass in GeV
-    const double M_Lambda = 1.115683; // mass in GeV
-
-    double ELambda = (M_Sigma * M_Sigma + M_Lambda * M_Lambda) / (2 * M_Sigma);
-    double EGamma = (M_Sigma * M_Sigma - M_Lambda * M_Lambda) / (2 * M_Sigma);
-    double p = EGamma;
+void inline lab2cms(double Q2, double Ebeam, 
+     TLorentzVector Pefin, TLorentzVector PK, TLorentzVector /*PL*/, 
+     double &theta_hadr, double &phi_hadr)
+{
+  lab2cms(Q2, Ebeam, toFourVector(Pefin), toFourVector(PK), theta_hadr, phi_hadr);
+}
 
-    // ========= decaying izotropically ===================
-    double cosTh = rand3->Uniform(-1., 1.);
-    double sinTh = sqrt(1. - cosTh * cosTh);
-    double phi = rand3->Uniform(0., 2 * TMath::Pi());
 
-    // ============= Setting proton 4 vector
-    L_Lambda.SetPxPyPzE(p * sinTh * cos(phi), p * sinTh * sin(phi), p*cosTh, ELambda);
-    // ==== Bringing to the Lab frame
-    L_Lambda.Boost(L_Sigma.BoostVector());
-    // ============= Setting Gamma 4 vector
-    L_gamma.SetPxPyPzE(-p * sinTh * cos(phi), -p * sinTh * sin(phi), -p*cosTh, EGamma);
-    // ==== Bringing to the Lab frame
-    L_gamma.Boost(L_Lambda.BoostVector());
+// Rafo's L decay (one event; decayLambda for batches):
+// v_prod is moved from the production to the decay vertex
+void inline DecayLambda(TLorentzVector &L_Lambda, vector <double>& v_prod, TLorentzVector &L_prot, TLorentzVector & L_pim, TRandom3* rand3){
+    double u[3];
+    u[0] = rand3->Rndm();
+    u[1] = rand3->Rndm();
+    u[2] = rand3->Rndm();
+    FourVector parent = toFourVector(L_Lambda), p, pim;
+    decayLambda.decay(1, &parent, u, &p, &pim);
+    moveToDecayVertex(1, &parent, cTauLambda, &u[2], &v_prod[0]);
+    L_prot = toLorentz(p);
+    L_pim = toLorentz(pim);
+}
 
+// Sigma0 -> Lambda gamma, one event (decaySigma0 for batches)
+void inline DecaySigma(TLorentzVector &L_Sigma, TLorentzVector &L_Lambda, TLorentzVector &L_gamma, TRandom3* rand3) {
+    double u[2];
+    u[0] = rand3->Rndm();
+    u[1] = rand3->Rndm();
+    FourVector parent = toFourVector(L_Sigma), lambda, gamma;
+    decaySigma0.decay(1, &parent, u, &lambda, &gamma);
+    L_Lambda = toLorentz(lambda);
+    L_gamma = toLorentz(gamma);
 }
 
 
 // My version L decay is replaced by Rafo's version
 // my:
 /*
-void getLdecayProd(TLorentzVector &PL,
+void inline getLdecayProd(TLorentzVector &PL,
                    TLorentzVector &Ppfin, TLorentzVector &Ppim, TRandom* gRandom) {
 
    //4-momenta Ppfin and Ppim in PL rest frame
@@ -418,7 +277,7 @@ void getLdecayProd(TLorentzVector &PL,
 }
 */
 /*
-void getSdecayProd(TLorentzVector &PS, TLorentzVector &PL,
+void inline getSdecayProd(TLorentzVector &PS, TLorentzVector &PL,
                    TLorentzVector &Ppfin, TLorentzVector &Ppim, TLorentzVector &Pgam, TRandom* gRandom) {
 
    //4-momenta PL and Pgam in the PS rest frame
@@ -458,59 +317,17 @@ void getSdecayProd(TLorentzVector &PS, TLorentzVector &PL,
 }
 */
 
-// K-, proton
-void getL_1520_decayProd(TLorentzVector &PL,
+// K-, proton: Lambda(1520) (PL) -> p (Ppfin) K- (Pkmin), one event;
+// decayLambda1520 for batches
+void inline getL_1520_decayProd(TLorentzVector &PL,
                    TLorentzVector &Ppfin, TLorentzVector &Pkmin, TRandom* gRandom) {
-
-   //4-momenta Ppfin and Pkmin in PL rest frame
-   //Set energy components
-   double mL=massLambda1520;
-   Ppfin.SetXYZT(1.,1.,1.,(mL*mL+massProton2-massKaon2)/2./mL);
-   Pkmin.SetXYZT (1.,1.,1.,(mL*mL+massKaon2-massProton2)/2./mL);
-   
-   //Set momentum muduli and angles
-   Ppfin.SetRho(sqrt(Ppfin.E()*Ppfin.E()-massProton2));
-   Pkmin.SetRho (sqrt(Pkmin.E()*Pkmin.E()  - massKaon2));
-   
-   // pim means Pkmin, I forgot to change it
-   double cost      = randomIntvTR(-1., 1., gRandom);
-   double thetapfin = acos(cost);
-   double phipfin   = randomIntvTR(0.0, 2.*constantPi, gRandom);
-   double thetapim = constantPi-thetapfin;
-   double phipim   = phipfin+constantPi; if(phipim>2.*constantPi) phipim=phipim-2.*constantPi;
-   Ppfin.SetTheta(thetapfin);
-   Ppfin.SetPhi(phipfin);
-   Pkmin.SetTheta(thetapim);
-   Pkmin.SetPhi(phipim);
-        
-	
-   /*
-    cout << " SSSS " <<  Ppfin.E() + Ppim.E() << " " << endl;
-
-	cout << " EECMS " <<  Ppfin.E() << " " <<  Ppim.E() << " " << endl;
-	cout << " PPCMS " <<  Ppfin.Vect().Mag() << " " <<  Ppim.Vect().Mag() << " " << endl;
-	cout << " MMCMS " <<  Ppfin.M() << " " <<  Ppim.Mag() << " " << endl;
-	*/
-	 
-   // boost to the PL lab frame.
-   double vx = PL.Px()/PL.E();
-   double vy = PL.Py()/PL.E();
-   double vz = PL.Pz()/PL.E();
-   Ppfin.Boost(vx,vy,vz);
-   Pkmin.Boost (vx,vy,vz);
-	//cout << " PPLAB " <<  Ppfin.Vect().Mag() << " " <<  Ppim.Vect().Mag() << " " << endl;
-
- 	//cout << " PPLAB " <<  Ppfin.Vect().Z() << " " <<  Ppim.Vect().Z() << " " << endl;
-  
-
-
-   //Ppfin.SetXYZT(0.1,0.1,0.1,(mL*mL+massProton2-massPion2)/2./mL);
-   //Ppim.SetXYZT (0.1,0.1,0.1,(mL*mL+massPion2-massProton2)/2./mL);
-   //Ppfin.Boost(vx,vy,vz);
-   //Ppim.Boost (vx,vy,vz);
- 
-   //cout << " PPBOOST " <<  Ppfin.Vect().Mag() << " " <<  Ppim.Vect().Mag() << " " << endl;
-
+   double u[2];
+   u[0] = gRandom->Rndm();
+   u[1] = gRandom->Rndm();
+   FourVector parent = toFourVector(PL), p, kmin;
+   decayLambda1520.decay(1, &parent, u, &p, &kmin);
+   Ppfin = toLorentz(p);
+   Pkmin = toLorentz(kmin);
 }
 
 
@@ -546,7 +363,7 @@ return channel;
 // Calculate phi in sector frame and sector number 
 // from phi in lab frame
 // Angles are in degrees!!!
-double getPhiSectDeg(double phi, int &sect) {
+double inline getPhiSectDeg(double phi, int &sect) {
 
   double phiSect;
 
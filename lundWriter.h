@@ -0,0 +1,238 @@
+#ifndef _LUND_WRITER_H
+#define _LUND_WRITER_H
+
+//SYS LIBRARIES
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <charconv>
+
+#include "rootCompat.h"
+#include "constants.h"
+#include "kinematics.h"
+#include "eventRecord.h"
+
+using namespace std;
+
+
+// One generated event: kinematics, final state particles in LAB frame
+// and the vertex.
+struct Event {
+  double Q2, W;
+  // kaon (pion) angles in the CM frame
+  double cosThetaK, phiK;
+  TLorentzVector Pefin, PK, PL, Ppfin, Ppim, Pgam;
+  // photons of the pi0 decay (Pi0P_2g)
+  TLorentzVector gamma1, gamma2;
+  // production vertex, cm
+  double vx, vy, vz;
+  // vertex of the Lambda decay products
+  vector<double> v_prod;
+  // weighted mode: weight and proposal density
+  double weight, density;
+};
+
+
+// Writes events in lund format.
+// channel: 1-KL 2-KS 3-PiOP 4-PiN (see num_chanel)
+// tagged: the channel number is the last column of the header line
+// (events of several channels in one file)
+// precision: significant digits of the numbers (6 is the ostream default)
+//
+// The numbers are formatted with to_chars and appended to a string the
+// caller reuses, so a chunk of events goes to the file in one write. The
+// fields that do not change from event to event (the particle index,
+// charge, id and mass of every line) are made once in the constructor.
+// The lines also define the particles of the plain EventRecord of an
+// event (fillRecord), which is what write() formats.
+class LundWriter {
+
+  int channel;
+  bool isDec;
+  bool isLam1520;
+  bool pion_decay;
+  bool isWeighted;
+  bool isTagged;
+  int precision;
+
+  // one particle line: "index charge 1 id 0 0 ", momentum, " mass", vertex
+  struct Line {
+    string head;
+    TLorentzVector Event::*p;
+    string mass;
+    bool atDecayVertex;   // at v_prod (decay products of the Lambda)
+    int id;
+    double m;
+  };
+  string header;          // "nParticles 1 1 0 0 0 0 "
+  vector<Line> lines;
+
+  void addLine(int index, const char* charge, int id, TLorentzVector Event::*p,
+               const string& mass, bool atDecayVertex = false) {
+    Line l;
+    l.head = to_string(index) + " " + charge + " 1 " + to_string(id) + " 0 0 ";
+    l.p = p;
+    l.mass = " " + mass;
+    l.atDecayVertex = atDecayVertex;
+    l.id = id;
+    l.m = atof(mass.c_str());
+    lines.push_back(l);
+  }
+
+  void put(string &out, double x) const {
+    char text[32];
+    to_chars_result r = to_chars(text, text + sizeof(text), x, chars_format::general, precision);
+    out.append(text, r.ptr);
+  }
+
+  // " x y z "
+  void putVertex(string &out, double x, double y, double z) const {
+    out += ' '; put(out, x);
+    out += ' '; put(out, y);
+    out += ' '; put(out, z);
+    out += ' ';
+  }
+
+public:
+
+  LundWriter(int ch, bool dec, bool lam1520, bool pi0decay, bool weighted, bool tagged = false,
+             int digits = 6)
+    : channel(ch), isDec(dec), isLam1520(lam1520), pion_decay(pi0decay), isWeighted(weighted),
+      isTagged(tagged), precision(digits) {
+
+	 int nParticles = 3;
+	 if (pion_decay && channel==3) nParticles = 4;
+	 if (isDec && channel== 2) nParticles = 5;
+	 if ((isDec || isLam1520) && channel==1) nParticles = 4;
+	header = to_string(nParticles) + " 1 1 0 0 0 0 ";
+
+	addLine(1, "-1", lundIdElectron, &Event::Pefin, "0.0005");
+
+	// KLambda
+	if (channel==1){
+	  addLine(2, "1", lundIdKaonPlus, &Event::PK, "0.4936");
+	  // No decay L 1.1:
+	  if (!isDec && !isLam1520)
+	    addLine(3, "0", lundIdLambda, &Event::PL, to_string(massLambda).substr(0, 6));
+	  // Decay L 1.1:
+	  if (isDec && !isLam1520) {
+	    addLine(3, "1", lundIdProton, &Event::Ppfin, "0.9383", true);
+	    addLine(4, "-1", lundIdPiMinus, &Event::Ppim, "0.1396", true);
+	  }
+	  // Decay L 1.520:
+	  if (!isDec && isLam1520) {
+	    addLine(3, "1", lundIdProton, &Event::Ppfin, "0.9383");
+	    addLine(4, "-1", lundIdKaonMinus, &Event::Ppim, to_string(massKaon).substr(0, 6));
+	  }
+	}
+	// KSigma
+	if (channel==2){
+	  addLine(2, "1", lundIdKaonPlus, &Event::PK, "0.4936");
+	  if (!isDec)
+	    addLine(3, "0", lundIdSigmaZero, &Event::PL, "1.192");
+	  else {
+	    addLine(3, "1", lundIdProton, &Event::Ppfin, "0.9383", true);
+	    addLine(4, "-1", lundIdPiMinus, &Event::Ppim, "0.1396", true);
+	    addLine(5, " 0", lundIdGamma, &Event::Pgam, "0.");
+	  }
+	}
+	// Pi0P
+	if (channel==3){
+	  if (pion_decay){
+	    addLine(2, "0", 22, &Event::gamma1, "0.0");
+	    addLine(3, "0", 22, &Event::gamma2, "0.0");
+	    addLine(4, "1", lundIdProton, &Event::PL, "0.9382");
+	  } else {
+	    addLine(2, "0", lundIdPiZero, &Event::PK, "0.134");
+	    addLine(3, "1", lundIdProton, &Event::PL, "0.9382");
+	  }
+	}
+	// PiN
+	if (channel==4){
+	  addLine(2, "1", lundIdPiPlus, &Event::PK, "0.1395");
+	  addLine(3, "0", lundIdNeutron, &Event::PL, "0.939");
+	}
+  }
+
+  int getChannel() const { return channel; }
+
+  // number of particles (lines) of an event
+  int particles() const { return lines.size(); }
+
+  // the event as a plain record; component: index of the channel in the run
+  void fillRecord(const Event &ev, int component, EventRecord &r) const {
+	r.component = component;
+	r.channel = channel;
+	r.Q2 = ev.Q2;
+	r.W = ev.W;
+	r.nu = getomega(ev.Q2, ev.W);
+	r.cosThetaK = ev.cosThetaK;
+	r.phiK = ev.phiK;
+	r.weight = ev.weight;
+	r.density = ev.density;
+	r.vx = ev.vx;
+	r.vy = ev.vy;
+	r.vz = ev.vz;
+	r.nParticles = min((int)lines.size(), EventRecord::maxParticles);
+	for (int i=0; i<r.nParticles; i++) {
+	  const Line &l = lines[i];
+	  const TLorentzVector &v = ev.*(l.p);
+	  Particle &p = r.particles[i];
+	  p.pid = l.id;
+	  p.px = v.Px();
+	  p.py = v.Py();
+	  p.pz = v.Pz();
+	  p.E = v.E();
+	  p.mass = l.m;
+	  if (l.atDecayVertex) { p.vx = ev.v_prod.at(0); p.vy = ev.v_prod.at(1); p.vz = ev.v_prod.at(2); }
+	  else { p.vx = ev.vx; p.vy = ev.vy; p.vz = ev.vz; }
+	}
+  }
+
+  // append the event to out
+  void write(string &out, const Event &ev) const {
+	EventRecord r;
+	fillRecord(ev, 0, r);
+	write(out, r);
+  }
+
+  // append the record (of this channel) to out
+  void write(string &out, const EventRecord &r) const {
+
+	out += header;
+	out += ' '; put(out, r.W);
+	out += ' '; put(out, r.Q2);
+	out += ' '; put(out, r.nu);
+	if (isWeighted) {
+	  out += ' '; put(out, r.weight);
+	  out += ' '; put(out, r.density);
+	}
+	if (isTagged) { out += ' '; out += to_string(channel); }
+	out += '\n';
+
+	// the vertex is the same on most lines
+	string vertex, decayVertex;
+	putVertex(vertex, r.vx, r.vy, r.vz);
+
+	for (int i=0; i<r.nParticles; i++) {
+	  const Line &l = lines[i];
+	  const Particle &p = r.particles[i];
+	  out += l.head;
+	  put(out, p.px); out += ' ';
+	  put(out, p.py); out += ' ';
+	  put(out, p.pz); out += ' ';
+	  put(out, p.E);
+	  out += l.mass;
+	  if (l.atDecayVertex) {
+	    if (decayVertex.empty()) putVertex(decayVertex, p.vx, p.vy, p.vz);
+	    out += decayVertex;
+	  }
+	  else out += vertex;
+	  out += '\n';
+	}
+  }
+
+};
+
+#endif
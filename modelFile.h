@@ -0,0 +1,252 @@
+#ifndef _MODEL_FILE_H
+#define _MODEL_FILE_H
+
+//SYS LIBRARIES
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Binary image of the tables of one channel, written by convertModel and
+// mapped into memory by Sigma at start-up instead of parsing the text files.
+//
+// Layout: header, table of named arrays, table of source files, then the
+// arrays of doubles, each starting at a multiple of 64 bytes. Scalars are
+// arrays of length one. The source table has the size and modification
+// time of every text file the arrays were made from; if one of them is
+// changed afterwards the image is stale and is not used.
+class ModelFile {
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    int32_t channel;
+    uint32_t nArrays;
+    uint32_t nSources;
+    uint32_t reserved;
+    uint64_t fileSize;
+  };
+  struct ArrayEntry {
+    char name[24];
+    uint64_t count;
+    uint64_t offset;
+  };
+  struct SourceEntry {
+    char name[112];
+    int64_t size;
+    int64_t mtime;
+  };
+
+  static const uint32_t version = 1;
+  static const uint32_t byteOrder = 0x01020304;
+  static const int alignment = 64;
+
+  // writing
+  vector<string> names;
+  vector< vector<double> > arrays;
+
+  // reading
+  void* map;
+  size_t mapSize;
+  const Header* header;
+  const ArrayEntry* entries;
+
+  static bool fileStamp(const string& path, int64_t &size, int64_t &mtime) {
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0) return false;
+    size = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+  }
+
+public:
+
+  ModelFile() : map(0), mapSize(0), header(0), entries(0) {}
+  ~ModelFile() { close(); }
+
+  void add(const string& name, const vector<double>& a) {
+    names.push_back(name);
+    arrays.push_back(a);
+  }
+  void add(const string& name, double x) { add(name, vector<double>(1, x)); }
+
+  // write the arrays added so far; sources are relative to dataPath
+  bool write(const string& path, int channel, const string& dataPath, const vector<string>& sources) const
+  {
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "GENKYMDL", 8);
+    h.version = version;
+    h.byteOrder = byteOrder;
+    h.channel = channel;
+    h.nArrays = arrays.size();
+    h.nSources = sources.size();
+
+    vector<ArrayEntry> table(arrays.size());
+    uint64_t offset = sizeof(Header) + table.size()*sizeof(ArrayEntry) + sources.size()*sizeof(SourceEntry);
+    for(size_t i=0; i<arrays.size(); i++) {
+      if(names[i].size() >= sizeof(table[i].name)) {
+        cerr << " Error! model array name " << names[i] << " is too long" << endl;
+        return false;
+      }
+      memset(&table[i], 0, sizeof(ArrayEntry));
+      strcpy(table[i].name, names[i].c_str());
+      offset = (offset + alignment-1)/alignment*alignment;
+      table[i].count = arrays[i].size();
+      table[i].offset = offset;
+      offset += arrays[i].size()*sizeof(double);
+    }
+    h.fileSize = offset;
+
+    vector<SourceEntry> stamps(sources.size());
+    for(size_t i=0; i<sources.size(); i++) {
+      memset(&stamps[i], 0, sizeof(SourceEntry));
+      if(sources[i].size() >= sizeof(stamps[i].name)
+         || !fileStamp(dataPath + "/" + sources[i], stamps[i].size, stamps[i].mtime)) {
+        cerr << " Error! can not stat model source " << sources[i] << endl;
+        return false;
+      }
+      strcpy(stamps[i].name, sources[i].c_str());
+    }
+
+    // write to a temporary file and rename, so readers never see a partial file
+    string tmp = path + ".tmp" + to_string((long long)getpid());
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if(f == NULL) {
+      cerr << " Error! can not write model file " << tmp << endl;
+      return false;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    if(!table.empty())  ok = ok && fwrite(&table[0], sizeof(ArrayEntry), table.size(), f) == table.size();
+    if(!stamps.empty()) ok = ok && fwrite(&stamps[0], sizeof(SourceEntry), stamps.size(), f) == stamps.size();
+    static const char zeros[alignment] = {0};
+    for(size_t i=0; i<arrays.size() && ok; i++) {
+      long pos = ftell(f);
+      ok = fwrite(zeros, 1, table[i].offset - pos, f) == table[i].offset - pos;
+      if(!arrays[i].empty()) ok = ok && fwrite(&arrays[i][0], sizeof(double), arrays[i].size(), f) == arrays[i].size();
+    }
+    ok = (fclose(f) == 0) && ok;
+    if(!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+      cerr << " Error! can not write model file " << path << endl;
+      remove(tmp.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  // Map a model file. False (quietly) if there is none; false with a
+  // message if it is broken, for another channel or older than its sources.
+  bool open(const string& path, int channel, const string& dataPath)
+  {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+      ::close(fd);
+      cout << " Model file " << path << " is broken, reading the text tables" << endl;
+      return false;
+    }
+    mapSize = st.st_size;
+    map = mmap(0, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED) {
+      map = 0;
+      cout << " Model file " << path << " can not be mapped, reading the text tables" << endl;
+      return false;
+    }
+
+    header = (const Header*)map;
+    const char* base = (const char*)map;
+    bool ok = memcmp(header->magic, "GENKYMDL", 8) == 0 && header->version == version
+           && header->byteOrder == byteOrder && header->fileSize == mapSize
+           && sizeof(Header) + header->nArrays*sizeof(ArrayEntry)
+              + header->nSources*sizeof(SourceEntry) <= mapSize;
+    if(ok) {
+      entries = (const ArrayEntry*)(base + sizeof(Header));
+      for(uint32_t i=0; i<header->nArrays && ok; i++)
+        ok = entries[i].offset % sizeof(double) == 0
+          && entries[i].offset + entries[i].count*sizeof(double) <= mapSize;
+    }
+    if(!ok) {
+      cout << " Model file " << path << " is broken or of another version, reading the text tables" << endl;
+      close();
+      return false;
+    }
+    if(header->channel != channel) {
+      cout << " Model file " << path << " is for another channel, reading the text tables" << endl;
+      close();
+      return false;
+    }
+
+    // a source that is gone is not checked, one that differs is stale
+    const SourceEntry* sources = (const SourceEntry*)(entries + header->nArrays);
+    for(uint32_t i=0; i<header->nSources; i++) {
+      int64_t size, mtime;
+      string name(sources[i].name, strnlen(sources[i].name, sizeof(sources[i].name)));
+      if(fileStamp(dataPath + "/" + name, size, mtime) && (size != sources[i].size || mtime != sources[i].mtime)) {
+        cout << " Model file " << path << " is older than " << name << ", reading the text tables" << endl;
+        close();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void close()
+  {
+    if(map != 0) munmap(map, mapSize);
+    map = 0;
+    mapSize = 0;
+    header = 0;
+    entries = 0;
+  }
+
+  // index of the array called name, -1 if the file has none
+  int find(const string& name) const
+  {
+    if(header == 0) return -1;
+    for(uint32_t i=0; i<header->nArrays; i++)
+      if(strncmp(entries[i].name, name.c_str(), sizeof(entries[i].name)) == 0) return i;
+    return -1;
+  }
+
+  // true if get(name, x) will succeed
+  bool has(const string& name, const vector<double>&) const { return find(name) >= 0; }
+  template <class T>
+  bool has(const string& name, const T&) const
+  {
+    int i = find(name);
+    return i >= 0 && entries[i].count == 1;
+  }
+
+  bool get(const string& name, vector<double>& a) const
+  {
+    int i = find(name);
+    if(i < 0) return false;
+    const double* x = (const double*)((const char*)map + entries[i].offset);
+    a.assign(x, x + entries[i].count);
+    return true;
+  }
+
+  template <class T>
+  bool get(const string& name, T &x) const
+  {
+    int i = find(name);
+    if(i < 0 || entries[i].count != 1) return false;
+    x = (T)*(const double*)((const char*)map + entries[i].offset);
+    return true;
+  }
+
+};
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef _OUTPUT_FILE_H
+#define _OUTPUT_FILE_H
+
+//SYS LIBRARIES
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <csignal>
+#include <chrono>
+
+#include <zlib.h>
+#ifdef GENKY_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+// Output file of the event loop. The chunks of text are queued and written
+// by a thread of its own, compressed on the way if the name ends with .gz
+// (zlib) or .zst (zstd, built with -DGENKY_ZSTD), so neither the disk nor
+// the compression holds up the generation. A compressed file is a single
+// stream: zcat, zstdcat or gzopen read it from the start as it is written.
+// The file may be a named pipe, or an open descriptor (stdout): a reader
+// that is slow makes the writes and then the event loop wait, one that
+// exits makes the writes fail (instead of killing the generator by SIGPIPE).
+class OutputFile {
+
+  enum Format { plain, gzip, zstd };
+  Format format = plain;
+  string path;
+  FILE* file = 0;
+  gzFile gz = 0;
+#ifdef GENKY_ZSTD
+  ZSTD_CCtx* cctx = 0;
+  string zbuffer;
+#endif
+
+  thread writer;
+  mutex queueMutex;
+  condition_variable queueCond;
+  deque<string> queue;
+  // the queue is bounded: a slow disk makes the event loop wait
+  // instead of keeping the whole output in memory
+  static const size_t maxQueued = 64;
+  bool isClosing = false;
+  atomic<bool> isFailed{false};
+  // seconds of the writer thread in writing (compressing) the blocks
+  double writeTime = 0.;
+
+  static bool endsWith(const string& s, const string& end) {
+    return s.size() >= end.size() && s.compare(s.size()-end.size(), end.size(), end) == 0;
+  }
+
+  // write (compress) one block, false on an error
+  bool put(const string& text) {
+    if(text.empty()) return true;
+    if(format == gzip) return gzwrite(gz, text.data(), text.size()) == (int)text.size();
+#ifdef GENKY_ZSTD
+    if(format == zstd) return compress(text.data(), text.size(), ZSTD_e_continue);
+#endif
+    return fwrite(text.data(), 1, text.size(), file) == text.size();
+  }
+
+#ifdef GENKY_ZSTD
+  bool compress(const char* data, size_t size, ZSTD_EndDirective mode) {
+    ZSTD_inBuffer in = {data, size, 0};
+    while(true) {
+      ZSTD_outBuffer out = {&zbuffer[0], zbuffer.size(), 0};
+      size_t left = ZSTD_compressStream2(cctx, &out, &in, mode);
+      if(ZSTD_isError(left)) return false;
+      if(out.pos > 0 && fwrite(out.dst, 1, out.pos, file) != out.pos) return false;
+      if(mode == ZSTD_e_end ? left == 0 : in.pos == in.size) return true;
+    }
+  }
+#endif
+
+  void run() {
+    while(true) {
+      string text;
+      {
+        unique_lock<mutex> lock(queueMutex);
+        queueCond.wait(lock, [this]{ return !queue.empty() || isClosing; });
+        if(queue.empty()) return;
+        text.swap(queue.front());
+        queue.pop_front();
+      }
+      queueCond.notify_all();
+      auto start = chrono::steady_clock::now();
+      if(!isFailed && !put(text)) {
+        cerr << " Error! can not write output file " << path << endl;
+        isFailed = true;
+      }
+      writeTime += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+  }
+
+public:
+
+  OutputFile() {}
+  OutputFile(const OutputFile&) = delete;
+  OutputFile& operator=(const OutputFile&) = delete;
+  ~OutputFile() { close(); }
+
+  // false (the reason is printed) if this build can not write the file:
+  // .zst without -DGENKY_ZSTD; checked with the options, before the run
+  static bool isSupported(const string& name) {
+#ifndef GENKY_ZSTD
+    if(endsWith(name, ".zst")) {
+      cerr << " Error! " << name << ": the generator is built without zstd (-DGENKY_ZSTD -lzstd)" << endl;
+      return false;
+    }
+#endif
+    return true;
+  }
+
+  // fd >= 0: write plain text to this descriptor, name is only for messages
+  bool open(const string& name, int fd = -1) {
+    path = name;
+    if(endsWith(path, ".gz")) format = gzip;
+    else if(endsWith(path, ".zst")) format = zstd;
+    else format = plain;
+    if(fd < 0 && !isSupported(path)) return false;
+    signal(SIGPIPE, SIG_IGN);
+
+    if(fd >= 0) {
+      format = plain;
+      file = fdopen(fd, "wb");
+    }
+    // level 1: the higher levels compress slower than the events are made
+    else if(format == gzip) {
+      gz = gzopen(path.c_str(), "wb1");
+      if(gz != 0) gzbuffer(gz, 1 << 20);
+    }
+    else file = fopen(path.c_str(), "wb");
+    if(file == 0 && gz == 0) {
+      cerr << " Error! can not open output file " << path << endl;
+      return false;
+    }
+
+    if(format == zstd) {
+#ifdef GENKY_ZSTD
+      cctx = ZSTD_createCCtx();
+      ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, 3);
+      zbuffer.resize(ZSTD_CStreamOutSize());
+#endif
+    }
+
+    isClosing = false;
+    isFailed = false;
+    writer = thread(&OutputFile::run, this);
+    return true;
+  }
+
+  // false once a write has failed (disk full, the reader of a pipe is gone)
+  bool good() const { return !isFailed; }
+
+  // time spent in the writes, valid after close()
+  double getWriteTime() const { return writeTime; }
+
+  // queue a block of text; text is taken (left empty)
+  void write(string& text) {
+    unique_lock<mutex> lock(queueMutex);
+    queueCond.wait(lock, [this]{ return queue.size() < maxQueued; });
+    queue.push_back(string());
+    queue.back().swap(text);
+    lock.unlock();
+    queueCond.notify_all();
+  }
+
+  // write out the queue and close the file, false if anything failed
+  bool close() {
+    if(!writer.joinable()) return !isFailed;
+    {
+      lock_guard<mutex> lock(queueMutex);
+      isClosing = true;
+    }
+    queueCond.notify_all();
+    writer.join();
+
+    bool ok = !isFailed;
+#ifdef GENKY_ZSTD
+    if(cctx != 0) {
+      ok = ok && compress(0, 0, ZSTD_e_end);
+      ZSTD_freeCCtx(cctx);
+      cctx = 0;
+    }
+#endif
+    if(gz != 0) ok = (gzclose(gz) == Z_OK) && ok;
+    if(file != 0) ok = (fclose(file) == 0) && ok;
+    gz = 0;
+    file = 0;
+    if(!ok && !isFailed) cerr << " Error! can not write output file " << path << endl;
+    isFailed = !ok;
+    return ok;
+  }
+
+};
+
+#endif
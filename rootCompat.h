@@ -0,0 +1,121 @@
+#ifndef _ROOT_COMPAT_H
+#define _ROOT_COMPAT_H
+
+// The ROOT classes the core of the generator uses: TLorentzVector and the
+// random engines TRandom, TRandom3 and TRandomMT64. With -DGENKY_NO_ROOT
+// they are replaced by the small classes below, with the same names and
+// methods, so the generator (lund output) builds and starts without ROOT;
+// only the .root output needs ROOT itself (rootWriter.h).
+//
+// The engines are the same Mersenne twisters as ROOT's, seeded the same
+// way (TRandom3 from a 32 bit seed, TRandomMT64 from a 64 bit one), with
+// uniform numbers in (0, 1]: the events are statistically the same as with
+// ROOT, though not bit for bit.
+
+#ifndef GENKY_NO_ROOT
+
+//ROOT LIBRARIES
+#include <TLorentzVector.h>
+#include <TRandom.h>
+#include <TRandom3.h>
+#include <TRandomGen.h>
+
+#else
+
+//SYS LIBRARIES
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+
+class TLorentzVector {
+
+  double fX = 0., fY = 0., fZ = 0., fE = 0.;
+
+public:
+
+  TLorentzVector() {}
+  TLorentzVector(double x, double y, double z, double t) : fX(x), fY(y), fZ(z), fE(t) {}
+
+  double X() const { return fX; }
+  double Y() const { return fY; }
+  double Z() const { return fZ; }
+  double T() const { return fE; }
+  double Px() const { return fX; }
+  double Py() const { return fY; }
+  double Pz() const { return fZ; }
+  double E() const { return fE; }
+  double P() const { return std::sqrt(fX*fX + fY*fY + fZ*fZ); }
+  double Mag2() const { return fE*fE - fX*fX - fY*fY - fZ*fZ; }
+  double Mag() const { double mm = Mag2(); return mm < 0. ? -std::sqrt(-mm) : std::sqrt(mm); }
+  double M() const { return Mag(); }
+
+  void SetXYZT(double x, double y, double z, double t) { fX = x; fY = y; fZ = z; fE = t; }
+  void SetPxPyPzE(double x, double y, double z, double t) { SetXYZT(x, y, z, t); }
+
+  // boost by the velocity (bx, by, bz), as ROOT does it
+  void Boost(double bx, double by, double bz) {
+    double b2 = bx*bx + by*by + bz*bz;
+    double gamma = 1./std::sqrt(1. - b2);
+    double bp = bx*fX + by*fY + bz*fZ;
+    double gamma2 = b2 > 0 ? (gamma - 1.)/b2 : 0.;
+    fX += gamma2*bp*bx + gamma*bx*fE;
+    fY += gamma2*bp*by + gamma*by*fE;
+    fZ += gamma2*bp*bz + gamma*bz*fE;
+    fE = gamma*(fE + bp);
+  }
+
+  TLorentzVector operator+(const TLorentzVector &o) const { return TLorentzVector(fX+o.fX, fY+o.fY, fZ+o.fZ, fE+o.fE); }
+  TLorentzVector operator-(const TLorentzVector &o) const { return TLorentzVector(fX-o.fX, fY-o.fY, fZ-o.fZ, fE-o.fE); }
+
+};
+
+
+class TRandom {
+public:
+  virtual ~TRandom() {}
+  // uniform in (0, 1]
+  virtual double Rndm() = 0;
+  virtual void SetSeed(unsigned long long seed) = 0;
+  virtual const char* ClassName() const = 0;
+  double Uniform(double x1, double x2) { return x1 + (x2 - x1)*Rndm(); }
+  double Uniform(double x) { return x*Rndm(); }
+  void RndmArray(int n, double *array) { for(int i=0; i<n; i++) array[i] = Rndm(); }
+};
+
+
+// MT19937, 32 bit numbers; 0 is skipped
+class TRandom3 : public TRandom {
+  std::mt19937 engine;
+public:
+  TRandom3(unsigned int seed = 4357) : engine(seed) {}
+  double Rndm() override {
+    uint32_t y;
+    while((y = engine()) == 0);
+    return y*2.3283064365386963e-10;
+  }
+  void SetSeed(unsigned long long seed) override { engine.seed((uint32_t)seed); }
+  const char* ClassName() const override { return "TRandom3"; }
+};
+
+
+// MT19937-64, 64 bit numbers; 0 is skipped
+class TRandomMT64 : public TRandom {
+  std::mt19937_64 engine;
+public:
+  TRandomMT64() {}
+  double Rndm() override {
+    uint64_t y;
+    while((y = engine()) == 0);
+    return y*(1./18446744073709551615.);
+  }
+  void SetSeed(unsigned long long seed) override { engine.seed(seed); }
+  const char* ClassName() const override { return "TRandomMT64"; }
+};
+
+
+inline TRandom *gRandom = 0;
+
+#endif
+
+#endif
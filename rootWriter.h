@@ -0,0 +1,209 @@
+#ifndef _ROOT_WRITER_H
+#define _ROOT_WRITER_H
+
+//SYS LIBRARIES
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "eventRecord.h"
+
+using namespace std;
+
+
+#ifndef GENKY_NO_ROOT
+
+//ROOT LIBRARIES
+#include <RVersion.h>
+#include <TFile.h>
+#include <TTree.h>
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,36,0)
+#define GENKY_RNTUPLE
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleWriter.hxx>
+#include <ROOT/RNTupleWriteOptions.hxx>
+#endif
+
+
+// Writes events into the tree "events" of a ROOT file, one branch per
+// quantity: the generated Q2, W, nu, cosThetaK, phiK (CM frame), vertex,
+// channel, weight and density, and arrays over the particles of the lund
+// file (id, momentum, energy, mass, vertex). With rntuple the same columns
+// go into an RNTuple (ROOT 6.36 or newer) instead of a TTree.
+class RootWriter {
+
+  static const int maxParticles = 8;
+  // baskets of 256 kB and clusters of 32 MB: few large reads when
+  // the columns are read through from the start
+  static const int basketSize = 256000;
+  static const long long clusterBytes = 32000000;
+  // LZ4: what ROOT recommends for files that are read more than written
+  static const int compression = 404;
+
+  string path;
+  TFile *file = 0;
+  TTree *tree = 0;
+
+  int channel, nParticles;
+  double Q2, W, nu, cosThetaK, phiK, weight, density, vx, vy, vz;
+  int pid[maxParticles];
+  double px[maxParticles], py[maxParticles], pz[maxParticles], E[maxParticles], mass[maxParticles];
+  double pvx[maxParticles], pvy[maxParticles], pvz[maxParticles];
+
+#ifdef GENKY_RNTUPLE
+  unique_ptr<ROOT::RNTupleWriter> ntuple;
+  // fields of the RNTuple, in the order of names below
+  vector< shared_ptr<double> > scalars;
+  shared_ptr<int> fChannel;
+  shared_ptr< vector<int> > fPid;
+  vector< shared_ptr< vector<double> > > arrays;
+#endif
+
+  static const char* const* scalarNames() {
+    static const char* const names[] = {"Q2", "W", "nu", "cosThetaK", "phiK", "weight", "density", "vx", "vy", "vz", 0};
+    return names;
+  }
+  static const char* const* arrayNames() {
+    static const char* const names[] = {"px", "py", "pz", "E", "mass", "pvx", "pvy", "pvz", 0};
+    return names;
+  }
+  double* scalar(int i) {
+    double* p[] = {&Q2, &W, &nu, &cosThetaK, &phiK, &weight, &density, &vx, &vy, &vz};
+    return p[i];
+  }
+  double* array(int i) {
+    double* p[] = {px, py, pz, E, mass, pvx, pvy, pvz};
+    return p[i];
+  }
+
+public:
+
+  RootWriter() {}
+  RootWriter(const RootWriter&) = delete;
+  RootWriter& operator=(const RootWriter&) = delete;
+  ~RootWriter() { close(); }
+
+  static bool hasRNTuple() {
+#ifdef GENKY_RNTUPLE
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  bool open(const string& name, bool rntuple = false) {
+    path = name;
+    if(rntuple) {
+#ifdef GENKY_RNTUPLE
+      auto model = ROOT::RNTupleModel::Create();
+      fChannel = model->MakeField<int>("channel");
+      for(int i=0; scalarNames()[i] != 0; i++) scalars.push_back(model->MakeField<double>(scalarNames()[i]));
+      fPid = model->MakeField< vector<int> >("pid");
+      for(int i=0; arrayNames()[i] != 0; i++) arrays.push_back(model->MakeField< vector<double> >(arrayNames()[i]));
+      ROOT::RNTupleWriteOptions options;
+      options.SetCompression(compression);
+      ntuple = ROOT::RNTupleWriter::Recreate(std::move(model), "events", path, options);
+      return true;
+#else
+      cerr << " Error! RNTuple output needs ROOT 6.36 or newer, this is " << ROOT_RELEASE << endl;
+      return false;
+#endif
+    }
+
+    file = TFile::Open(path.c_str(), "RECREATE");
+    if(file == 0 || file->IsZombie()) {
+      cerr << " Error! can not open output file " << path << endl;
+      delete file;
+      file = 0;
+      return false;
+    }
+    file->SetCompressionSettings(compression);
+    tree = new TTree("events", "genKYandOnePion events");
+    tree->SetAutoFlush(-clusterBytes);
+    tree->Branch("channel", &channel, "channel/I", basketSize);
+    for(int i=0; scalarNames()[i] != 0; i++)
+      tree->Branch(scalarNames()[i], scalar(i), (string(scalarNames()[i]) + "/D").c_str(), basketSize);
+    tree->Branch("nParticles", &nParticles, "nParticles/I", basketSize);
+    tree->Branch("pid", pid, "pid[nParticles]/I", basketSize);
+    for(int i=0; arrayNames()[i] != 0; i++)
+      tree->Branch(arrayNames()[i], array(i), (string(arrayNames()[i]) + "[nParticles]/D").c_str(), basketSize);
+    return true;
+  }
+
+  // the event and its particles, those of the lines of the lund file
+  void fill(const EventRecord &ev) {
+    channel = ev.channel;
+    Q2 = ev.Q2;
+    W = ev.W;
+    nu = ev.nu;
+    cosThetaK = ev.cosThetaK;
+    phiK = ev.phiK;
+    weight = ev.weight;
+    density = ev.density;
+    vx = ev.vx;
+    vy = ev.vy;
+    vz = ev.vz;
+    nParticles = min(ev.nParticles, maxParticles);
+    for(int i=0; i<nParticles; i++) {
+      const Particle &p = ev.particles[i];
+      pid[i] = p.pid;
+      px[i] = p.px;
+      py[i] = p.py;
+      pz[i] = p.pz;
+      E[i] = p.E;
+      mass[i] = p.mass;
+      pvx[i] = p.vx;
+      pvy[i] = p.vy;
+      pvz[i] = p.vz;
+    }
+
+#ifdef GENKY_RNTUPLE
+    if(ntuple) {
+      *fChannel = channel;
+      for(size_t i=0; i<scalars.size(); i++) *scalars[i] = *scalar(i);
+      fPid->assign(pid, pid + nParticles);
+      for(size_t i=0; i<arrays.size(); i++) arrays[i]->assign(array(i), array(i) + nParticles);
+      ntuple->Fill();
+      return;
+    }
+#endif
+    tree->Fill();
+  }
+
+  bool close() {
+#ifdef GENKY_RNTUPLE
+    // the RNTuple is written out when its writer is destroyed
+    ntuple.reset();
+#endif
+    if(file == 0) return true;
+    file->cd();
+    bool ok = tree->Write() > 0;
+    file->Close();
+    delete file;
+    file = 0;
+    tree = 0;
+    if(!ok) cerr << " Error! can not write output file " << path << endl;
+    return ok;
+  }
+
+};
+
+#else
+
+// Built without ROOT (-DGENKY_NO_ROOT): there is no .root output
+class RootWriter {
+public:
+  static bool hasRNTuple() { return false; }
+  bool open(const string& name, bool /*rntuple*/ = false) {
+    cerr << " Error! " << name << ": the generator is built without ROOT (GENKY_NO_ROOT)" << endl;
+    return false;
+  }
+  void fill(const EventRecord &/*ev*/) {}
+  bool close() { return true; }
+};
+
+#endif
+
+#endif
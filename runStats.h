@@ -0,0 +1,172 @@
+#ifndef _RUN_STATS_H
+#define _RUN_STATS_H
+
+//SYS LIBRARIES
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+// seconds on a monotonic clock, for the stage timers
+double inline wallTime()
+{
+  return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// Counters of a run (or a part of it); they add up over chunks and threads
+struct GenStatistics {
+  long long nTrials = 0;
+  long long nAccepted = 0;
+  double sumW = 0.;
+  double sumW2 = 0.;
+  // seconds in the cross section of the proposals and in the
+  // kinematics of the accepted events
+  double d5sigmaTime = 0.;
+  double kinematicsTime = 0.;
+  // proposals above the envelope: their number, the largest
+  // d5sigma*jacobian/envelope, the copies of them written and those still
+  // to come at the end of a chunk, which are dropped
+  long long nOverflows = 0;
+  double maxOverflow = 0.;
+  long long nCopies = 0;
+  long long nDropped = 0;
+  // sum of the envelopes the unweighted events were accepted with, and
+  // those of the dropped copies
+  double sumEnvelope = 0.;
+
+  // the envelope of the cross section estimate envelope*nAccepted/nTrials:
+  // the mean one if it was raised during the run
+  double meanEnvelope(double envelope) const {
+    return (nAccepted > 0 && sumEnvelope > 0.) ? sumEnvelope/nAccepted : envelope;
+  }
+
+  void add(const GenStatistics& other) {
+    nTrials += other.nTrials;
+    nAccepted += other.nAccepted;
+    sumW += other.sumW;
+    sumW2 += other.sumW2;
+    d5sigmaTime += other.d5sigmaTime;
+    kinematicsTime += other.kinematicsTime;
+    nOverflows += other.nOverflows;
+    maxOverflow = max(maxOverflow, other.maxOverflow);
+    nCopies += other.nCopies;
+    nDropped += other.nDropped;
+    sumEnvelope += other.sumEnvelope;
+  }
+};
+
+
+// Where the time of a run went and how many proposals its events took.
+// The stages inside the event loop (cross section, kinematics, decays,
+// formatting) are summed over the threads; wall is the elapsed time of
+// the whole run. Written as JSON at the end of the run (--report).
+struct RunReport {
+
+  struct Channel {
+    string name;
+    long long trials = 0;
+    long long accepted = 0;
+    double loadTime = 0.;        // reading (mapping) the model, tabulating it
+    double envelopeTime = 0.;    // envelope search, VEGAS training or cells
+    double d5sigmaTime = 0.;     // cross section of the proposals
+    double kinematicsTime = 0.;  // momenta of the accepted events
+    long long overflows = 0;     // proposals above the envelope
+    double maxOverflow = 0.;     // largest d5sigma/envelope
+    long long copies = 0;        // copies of the overflow points written
+    long long dropped = 0;       // and dropped at the end of a chunk
+  };
+  vector<Channel> channels;
+
+  int threads = 1;
+  long long events = 0;
+  double wall = 0.;            // the whole run
+  double loopWall = 0.;        // the event loop
+  double decayTime = 0.;
+  double formatTime = 0.;      // lund text (or the ROOT tree)
+  double outputTime = 0.;      // writing and compressing the file
+  double outputWait = 0.;      // event loop waiting for the output
+
+  double eventsPerSecond() const { return loopWall > 0. ? events/loopWall : 0.; }
+
+  bool write(const string& path) const {
+    FILE* f = fopen(path.c_str(), "w");
+    if(f == NULL) {
+      cerr << " Error! can not write run report " << path << endl;
+      return false;
+    }
+    long long trials = 0, accepted = 0;
+    for(size_t k=0; k<channels.size(); k++) {
+      trials += channels[k].trials;
+      accepted += channels[k].accepted;
+    }
+    fprintf(f, "{\n");
+    fprintf(f, "  \"threads\": %d,\n", threads);
+    fprintf(f, "  \"events\": %lld,\n", events);
+    fprintf(f, "  \"trials\": %lld,\n", trials);
+    fprintf(f, "  \"accepted\": %lld,\n", accepted);
+    fprintf(f, "  \"acceptance\": %.6g,\n", trials > 0 ? (double)accepted/trials : 0.);
+    fprintf(f, "  \"wall_seconds\": %.6g,\n", wall);
+    fprintf(f, "  \"event_loop_seconds\": %.6g,\n", loopWall);
+    fprintf(f, "  \"events_per_second\": %.6g,\n", eventsPerSecond());
+    fprintf(f, "  \"seconds\": {\"decays\": %.6g, \"format\": %.6g, \"output\": %.6g, \"output_wait\": %.6g},\n",
+            decayTime, formatTime, outputTime, outputWait);
+    fprintf(f, "  \"channels\": [\n");
+    for(size_t k=0; k<channels.size(); k++) {
+      const Channel &c = channels[k];
+      fprintf(f, "    {\"name\": \"%s\", \"trials\": %lld, \"accepted\": %lld, \"acceptance\": %.6g, "
+                 "\"overflows\": %lld, \"max_overflow\": %.6g, \"overflow_copies\": %lld, \"dropped_copies\": %lld, "
+                 "\"seconds\": {\"model_load\": %.6g, \"envelope\": %.6g, \"d5sigma\": %.6g, \"kinematics\": %.6g}}%s\n",
+              c.name.c_str(), c.trials, c.accepted, c.trials > 0 ? (double)c.accepted/c.trials : 0.,
+              c.overflows, c.maxOverflow, c.copies, c.dropped, c.loadTime, c.envelopeTime, c.d5sigmaTime, c.kinematicsTime,
+              k+1 < channels.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0;
+  }
+
+  void print() const {
+    cout << endl << " Timing: " << events << " events in " << loopWall << " s ("
+         << eventsPerSecond() << " events/s), whole run " << wall << " s" << endl;
+    for(size_t k=0; k<channels.size(); k++) {
+      const Channel &c = channels[k];
+      cout << "   " << c.name << ": model " << c.loadTime << " s, envelope " << c.envelopeTime
+           << " s, d5sigma " << c.d5sigmaTime << " s, kinematics " << c.kinematicsTime << " s" << endl;
+    }
+    cout << "   decays " << decayTime << " s, format " << formatTime << " s, output "
+         << outputTime << " s (waited " << outputWait << " s)" << endl;
+  }
+
+};
+
+
+// Progress of the event loop on stderr, at most every interval seconds
+class ProgressMeter {
+
+  long long total;
+  double interval;
+  double start, last;
+
+public:
+
+  ProgressMeter(long long nTotal, double seconds)
+    : total(nTotal), interval(seconds), start(wallTime()), last(start) {}
+
+  void update(long long done) {
+    if(interval <= 0.) return;
+    double now = wallTime();
+    if(now - last < interval && done < total) return;
+    last = now;
+    double rate = (now > start) ? done/(now - start) : 0.;
+    double left = (rate > 0.) ? (total - done)/rate : 0.;
+    fprintf(stderr, " Progress: %lld / %lld events (%.1f%%), %.0f events/s, %.0f s left\n",
+            done, total, total > 0 ? 100.*done/total : 100., rate, left);
+  }
+
+};
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef _RUN_SUMMARY_H
+#define _RUN_SUMMARY_H
+
+//SYS LIBRARIES
+#include <cstdio>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Summary of one run (or one shard of a batch production): the settings
+// that must agree between shards and the counters needed to normalize.
+// Shards of the same production are merged by adding the counters; the
+// cross section is estimated from the sums, nothing is regenerated.
+struct RunSummary {
+
+  string channel;
+  double ebeam = 0., q2min = 0., q2max = 0., wmin = 0., wmax = 0.;
+  string sampling;
+  int weighted = 0;
+  int decay = 0;
+  int lambda1520 = 0;
+  double envelopeScale = 1.;
+  // --tabulate and the table (SigmaTable::name): events of the table are
+  // not those of the exact model
+  int tabulate = 0;
+  string table = "none";
+  unsigned long long masterSeed = 0;
+  int shard = 0;
+  int nShards = 1;
+  // events requested per shard and the first random stream of the shard
+  long long events = 0;
+  long long firstChunk = 0;
+
+  long long trials = 0;
+  long long accepted = 0;
+  double envelope = 0.;
+  // sum over shards of envelope*accepted and of its variance
+  // (for unweighted events; the envelope may differ between shards)
+  double sumEA = 0.;
+  double varEA = 0.;
+  double sumW = 0.;
+  double sumW2 = 0.;
+
+  // integral of d5sigma over the generated box and its error
+  double crossSection() const {
+    if(trials == 0) return 0.;
+    return weighted ? sumW/trials : sumEA/trials;
+  }
+
+  double crossSectionError() const {
+    if(trials == 0) return 0.;
+    if(weighted) {
+      double mean = sumW/trials;
+      double var = sumW2/trials - mean*mean;
+      return (var > 0.) ? sqrt(var/trials) : 0.;
+    }
+    return sqrt(varEA)/trials;
+  }
+
+  // fill the counters of a single run
+  void setCounts(long long nTrials, long long nAccepted, double env, double w, double w2) {
+    trials = nTrials;
+    accepted = nAccepted;
+    envelope = env;
+    sumW = w;
+    sumW2 = w2;
+    double p = (nTrials > 0) ? (double)nAccepted/nTrials : 0.;
+    sumEA = env*nAccepted;
+    varEA = env*env*nTrials*p*(1.-p);
+  }
+
+  bool write(const string& path) const {
+    FILE* f = fopen(path.c_str(), "w");
+    if(f == NULL) {
+      cerr << " Error! can not write run summary " << path << endl;
+      return false;
+    }
+    fprintf(f, "genKYandOnePion-summary 1\n");
+    fprintf(f, "channel %s\n", channel.c_str());
+    fprintf(f, "ebeam %.17g\n", ebeam);
+    fprintf(f, "q2min %.17g\nq2max %.17g\n", q2min, q2max);
+    fprintf(f, "wmin %.17g\nwmax %.17g\n", wmin, wmax);
+    fprintf(f, "sampling %s\n", sampling.c_str());
+    fprintf(f, "weighted %d\n", weighted);
+    fprintf(f, "decay %d\nlambda1520 %d\n", decay, lambda1520);
+    fprintf(f, "envelope_scale %.17g\n", envelopeScale);
+    fprintf(f, "tabulate %d\ntable %s\n", tabulate, table.c_str());
+    fprintf(f, "master_seed %llu\n", masterSeed);
+    fprintf(f, "shard %d\nshards %d\n", shard, nShards);
+    fprintf(f, "events %lld\nfirst_chunk %lld\n", events, firstChunk);
+    fprintf(f, "trials %lld\naccepted %lld\n", trials, accepted);
+    fprintf(f, "envelope %.17g\n", envelope);
+    fprintf(f, "sum_envelope_accepted %.17g\nvar_envelope_accepted %.17g\n", sumEA, varEA);
+    fprintf(f, "sum_w %.17g\nsum_w2 %.17g\n", sumW, sumW2);
+    fprintf(f, "cross_section %.10g\ncross_section_error %.10g\n", crossSection(), crossSectionError());
+    return fclose(f) == 0;
+  }
+
+  bool read(const string& path) {
+    ifstream in(path.c_str());
+    string magic;
+    int version = 0;
+    in >> magic >> version;
+    if(!in.is_open() || magic != "genKYandOnePion-summary" || version != 1) {
+      cerr << " Error! " << path << " is not a run summary" << endl;
+      return false;
+    }
+    string name;
+    while(in >> name) {
+      if(name == "channel") in >> channel;
+      else if(name == "ebeam") in >> ebeam;
+      else if(name == "q2min") in >> q2min;
+      else if(name == "q2max") in >> q2max;
+      else if(name == "wmin") in >> wmin;
+      else if(name == "wmax") in >> wmax;
+      else if(name == "sampling") in >> sampling;
+      else if(name == "weighted") in >> weighted;
+      else if(name == "decay") in >> decay;
+      else if(name == "lambda1520") in >> lambda1520;
+      else if(name == "envelope_scale") in >> envelopeScale;
+      else if(name == "tabulate") in >> tabulate;
+      else if(name == "table") in >> table;
+      else if(name == "master_seed") in >> masterSeed;
+      else if(name == "shard") in >> shard;
+      else if(name == "shards") in >> nShards;
+      else if(name == "events") in >> events;
+      else if(name == "first_chunk") in >> firstChunk;
+      else if(name == "trials") in >> trials;
+      else if(name == "accepted") in >> accepted;
+      else if(name == "envelope") in >> envelope;
+      else if(name == "sum_envelope_accepted") in >> sumEA;
+      else if(name == "var_envelope_accepted") in >> varEA;
+      else if(name == "sum_w") in >> sumW;
+      else if(name == "sum_w2") in >> sumW2;
+      else { string skip; getline(in, skip); }   // derived values
+    }
+    return true;
+  }
+
+  // true if both summaries come from the same production; the shards must
+  // also have the same number of events, otherwise their streams overlap
+  bool isCompatible(const RunSummary& other) const {
+    return channel == other.channel && ebeam == other.ebeam
+        && q2min == other.q2min && q2max == other.q2max
+        && wmin == other.wmin && wmax == other.wmax
+        && sampling == other.sampling && weighted == other.weighted
+        && decay == other.decay && lambda1520 == other.lambda1520
+        && envelopeScale == other.envelopeScale
+        && tabulate == other.tabulate && table == other.table
+        && masterSeed == other.masterSeed && nShards == other.nShards
+        && events == other.events;
+  }
+
+  void add(const RunSummary& other) {
+    trials += other.trials;
+    accepted += other.accepted;
+    if(other.envelope > envelope) envelope = other.envelope;
+    sumEA += other.sumEA;
+    varEA += other.varEA;
+    sumW += other.sumW;
+    sumW2 += other.sumW2;
+  }
+
+  void print() const {
+    cout << " Channel: " << channel << " Ebeam: " << ebeam
+         << " Q2: " << q2min << " - " << q2max << " W: " << wmin << " - " << wmax << endl;
+    cout << " Proposals: " << trials << " events: " << accepted << endl;
+    if(weighted) {
+      double ess = (sumW2 > 0.) ? sumW*sumW/sumW2 : 0.;
+      cout << " Sum of weights: " << sumW << endl;
+      cout << " Sum of squared weights: " << sumW2 << endl;
+      cout << " Effective sample size: " << ess << endl;
+    }
+    cout << " Integrated cross section: " << crossSection() << " +- " << crossSectionError() << endl;
+  }
+
+};
+
+#endif
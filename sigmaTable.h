@@ -0,0 +1,360 @@
+#ifndef _SIGMA_TABLE_H
+#define _SIGMA_TABLE_H
+
+//SYS LIBRARIES
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "rootCompat.h"
+#include "constants.h"
+#include "sigmaValera.h"
+
+using namespace std;
+
+
+// The model of one run (channel and beam energy) tabulated on a uniform
+// grid in (Q2, W, cosThetaK): every node has the three phi harmonics of the
+// reduced cross section d5sigma/flux, so
+//   d5sigma = flux(Q2, W) * |a0 + a1*cos(2phiK) + a2*cos(phiK)|
+// with the a's from one trilinear interpolation and the photon flux (and
+// the kinematic limits) of Sigma::d5sigma computed exactly. This replaces
+// the chain of cases of get_d5CS and get_CS by a fixed number of operations.
+// As in the model, the abs is only taken inside the low Q2 tables (the
+// flag of the nearest (Q2, W) node), elsewhere a negative value stays.
+//
+// Nodes outside of the kinematics of the beam take the harmonics of the
+// nearest node inside, so the cells on the boundary interpolate smoothly;
+// so do the (Q2, W) nodes where the model is not finite, if any.
+// Across the steps of the model (the W windows of get_CS, the change from
+// the tables to the extrapolation at Q_max_channel) the table is linear
+// instead: check() measures the deviation from the exact model.
+class SigmaTable {
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    int32_t nodes[3];
+    uint32_t keySize;
+    double lo[3], hi[3];
+    double Ebeam, threshold;
+    double maxDeviation, meanDeviation;
+    int64_t nNonFinite;
+  };
+
+  static const uint32_t version = 2;
+  static const uint32_t byteOrder = 0x01020304;
+
+  double Ebeam = 0., threshold = 0.;
+  int n[3] = {0, 0, 0};
+  double lo[3] = {0., 0., 0.}, hi[3] = {0., 0., 0.}, step[3] = {1., 1., 1.};
+  // a0, a1, a2 of node (iQ2, iW, iCos), cos runs fastest
+  vector<float> a;
+  // 1 if the model takes the abs at node (iQ2, iW)
+  vector<char> isAbs;
+
+  // deviation from the exact model and the points where the table or the
+  // model is not finite, see check()
+  double maxDeviation = 0., meanDeviation = 0.;
+  long long nNonFinite = 0;
+
+  size_t node(int iQ2, int iW, int iCos) const { return ((size_t)iQ2*n[1] + iW)*n[2] + iCos; }
+  double nodeValue(int k, int i) const { return lo[k] + step[k]*i; }
+
+  void setSteps() {
+    for(int k=0; k<3; k++) step[k] = (n[k] > 1) ? (hi[k] - lo[k])/(n[k] - 1) : 1.;
+  }
+
+  // cell i of the variable k that contains x and the position t in it
+  void locate(int k, double x, int &i, double &t) const {
+    double u = (x - lo[k])/step[k];
+    i = (int)u;
+    if(i < 0) i = 0;
+    if(i > n[k] - 2) i = n[k] - 2;
+    t = u - i;
+  }
+
+  // copy the harmonics of (fromQ2, fromW) to (iQ2, iW), for all cos
+  void copyRow(int iQ2, int iW, int fromQ2, int fromW) {
+    isAbs[iQ2*n[1] + iW] = isAbs[fromQ2*n[1] + fromW];
+    for(int iCos=0; iCos<n[2]; iCos++)
+      for(int j=0; j<3; j++) a[3*node(iQ2, iW, iCos) + j] = a[3*node(fromQ2, fromW, iCos) + j];
+  }
+
+public:
+
+  // the photon flux of Sigma::d5sigma, 0 outside of its kinematic limits;
+  // the limits without asin, as in the batch Sigma::d5sigma
+  double flux(double Q2, double W) const {
+    const double sinMax = sin(3.1415927/4);
+    double W2 = W*W;
+    double omega = (W2 + Q2 - massProton2)/(2*massProton);
+    double EE2 = Ebeam*(Ebeam - omega);
+    double sinus = sqrt(Q2/(4*EE2));
+    double arg = 1. - Q2/(2.*EE2);
+    bool ok = (Q2/(4*EE2) <= 1) && (2 - Q2/(2*EE2) > 0) && (-Q2/(2*EE2) <= 0) && (omega >= 0) && (Ebeam - omega >= 0)
+              && (sinus <= sinMax) && (W >= threshold) && (Q2 >= 0.0001) && (Q2 <= 30) && (W <= 5)
+              && (arg <= 1.) && (arg >= -1.);
+    if(!ok) return 0.;
+    double epsilon = 1./(1. + (2.*(Q2 + omega*omega))/(4.*Ebeam*(Ebeam - omega) - Q2));
+    return (constantAlpha/(2.*constantPi2))*((Ebeam - omega)/Ebeam)*(W2 - massProton2)/(2.*massProton*Q2)*(1./(1. - epsilon));
+  }
+
+  // the interpolated harmonics of the reduced cross section; abs: the
+  // model takes the abs of a negative value there
+  void harmonics(double Q2, double W, double cosThetaK, double &a0, double &a1, double &a2, bool &abs) const {
+    int i[3];
+    double t[3];
+    locate(0, Q2, i[0], t[0]);
+    locate(1, W, i[1], t[1]);
+    locate(2, cosThetaK, i[2], t[2]);
+    abs = isAbs[(i[0] + (t[0] > 0.5))*n[1] + i[1] + (t[1] > 0.5)];
+    // the two cos nodes of a (Q2, W) node are next to each other
+    double wQW[4] = {(1. - t[0])*(1. - t[1]), (1. - t[0])*t[1], t[0]*(1. - t[1]), t[0]*t[1]};
+    double sum[3] = {0., 0., 0.};
+    for(int c=0; c<4; c++) {
+      const float *p = &a[3*node(i[0] + (c >> 1), i[1] + (c & 1), i[2])];
+      double w0 = wQW[c]*(1. - t[2]), w1 = wQW[c]*t[2];
+      sum[0] += w0*p[0] + w1*p[3];
+      sum[1] += w0*p[1] + w1*p[4];
+      sum[2] += w0*p[2] + w1*p[5];
+    }
+    a0 = sum[0]; a1 = sum[1]; a2 = sum[2];
+  }
+
+  // d5sigma of the table, the arguments as in Sigma::d5sigma2
+  double d5sigma(double Q2, double W, double cosThetaK, double phiK) const {
+    if(phiK < 0 || phiK > 6.284) return 0.;
+    double f = flux(Q2, W);
+    if(f == 0.) return 0.;
+    double a0, a1, a2;
+    bool abs;
+    harmonics(Q2, W, cosThetaK, a0, a1, a2, abs);
+    double cosPhi = cos(phiK);
+    double value = a0 + a1*(2.*cosPhi*cosPhi - 1.) + a2*cosPhi;
+    return f*((value >= 0 || !abs) ? value : -value);
+  }
+
+  // Tabulate the model on nodes[0] x nodes[1] x nodes[2] nodes over
+  // [Q2min, Q2max] x [Wmin, Wmax] x [-0.999999, 0.999999] (W from just
+  // above the threshold if Wmin is below it: on the threshold the model is
+  // 0/0). The (Q2, W) rows are split over
+  // nThreads threads (0 - all cores) with a copy of the model each, the
+  // table does not depend on the number of threads.
+  void build(Sigma &model, int channel, double E, double Q2min, double Q2max,
+             double Wmin, double Wmax, const int nodes[3], int nThreads) {
+    Ebeam = E;
+    threshold = model.porog_ch(channel);
+    for(int k=0; k<3; k++) n[k] = max(nodes[k], 2);
+    lo[0] = Q2min;              hi[0] = Q2max;
+    lo[1] = max(Wmin, threshold + 1e-6); hi[1] = max(Wmax, lo[1]);
+    lo[2] = -0.999999;          hi[2] = 0.999999;
+    setSteps();
+    a.assign(3*(size_t)n[0]*n[1]*n[2], 0.f);
+    isAbs.assign(n[0]*n[1], 0);
+
+    int nRows = n[0]*n[1];
+    vector<char> isInside(nRows, 0);
+    if(nThreads <= 0) nThreads = thread::hardware_concurrency();
+    if(nThreads <= 0) nThreads = 1;
+    if(nThreads > nRows) nThreads = nRows;
+
+    atomic<int> nextRow(0);
+    auto fillRows = [&](Sigma *s) {
+      for(int row=nextRow++; row<nRows; row=nextRow++) {
+        int iQ2 = row/n[1], iW = row%n[1];
+        double Q2 = nodeValue(0, iQ2), W = nodeValue(1, iW);
+        if(flux(Q2, W) == 0.) continue;
+        bool isFinite = true;
+        for(int iCos=0; iCos<n[2]; iCos++) {
+          double a0, a1, a2;
+          bool abs;
+          s->reduced_harmonics(Ebeam, Q2, W, nodeValue(2, iCos), a0, a1, a2, abs);
+          float *p = &a[3*node(iQ2, iW, iCos)];
+          p[0] = a0; p[1] = a1; p[2] = a2;
+          isAbs[row] = abs;
+          isFinite = isFinite && isfinite(p[0]) && isfinite(p[1]) && isfinite(p[2]);
+        }
+        // a row with a value that is not finite is filled as one outside
+        isInside[row] = isFinite;
+      }
+    };
+    vector<Sigma> copies(nThreads-1, model);
+    vector<thread> workers;
+    for(int i=0; i<nThreads-1; i++) workers.push_back(thread(fillRows, &copies[i]));
+    fillRows(&model);
+    for(int i=0; i<nThreads-1; i++) workers[i].join();
+
+    // nodes outside of the kinematics (or not finite): the nearest node inside in W, then
+    // the nearest row in Q2 with a node inside
+    vector<char> rowInside(n[0], 0);
+    for(int iQ2=0; iQ2<n[0]; iQ2++) {
+      for(int iW=0; iW<n[1]; iW++) if(isInside[iQ2*n[1] + iW]) rowInside[iQ2] = 1;
+      if(!rowInside[iQ2]) continue;
+      for(int iW=0; iW<n[1]; iW++) {
+        if(isInside[iQ2*n[1] + iW]) continue;
+        for(int d=1; d<n[1]; d++) {
+          int from = -1;
+          if(iW - d >= 0 && isInside[iQ2*n[1] + iW - d]) from = iW - d;
+          else if(iW + d < n[1] && isInside[iQ2*n[1] + iW + d]) from = iW + d;
+          if(from < 0) continue;
+          copyRow(iQ2, iW, iQ2, from);
+          break;
+        }
+      }
+    }
+    for(int iQ2=0; iQ2<n[0]; iQ2++) {
+      if(rowInside[iQ2]) continue;
+      for(int d=1; d<n[0]; d++) {
+        int from = -1;
+        if(iQ2 - d >= 0 && rowInside[iQ2 - d]) from = iQ2 - d;
+        else if(iQ2 + d < n[0] && rowInside[iQ2 + d]) from = iQ2 + d;
+        if(from < 0) continue;
+        for(int iW=0; iW<n[1]; iW++) copyRow(iQ2, iW, from, iW);
+        break;
+      }
+    }
+  }
+
+  // Compare the table with the exact model at nPoints points drawn
+  // uniformly (with a fixed seed) over the table: the largest deviation
+  // relative to the largest d5sigma of the points, and the mean absolute
+  // deviation relative to the mean d5sigma. Q2, W, cosThetaK of the point
+  // of the largest deviation are returned in where. Points where the table
+  // or the model is not finite are counted (getNonFinite), not compared.
+  void check(Sigma &model, int nPoints, double where[3]) {
+    TRandomMT64 random;
+    random.SetSeed(12345);
+    double maxExact = 0., sumExact = 0., maxDev = 0., sumDev = 0.;
+    nNonFinite = 0;
+    for(int i=0; i<nPoints; i++) {
+      double Q2 = random.Uniform(lo[0], hi[0]);
+      double W = random.Uniform(lo[1], hi[1]);
+      double cosThetaK = random.Uniform(lo[2], hi[2]);
+      double phiK = random.Uniform(0., 2*constantPi);
+      double exact = model.d5sigma(Ebeam, Q2, W, acos(cosThetaK), phiK);
+      double tabulated = d5sigma(Q2, W, cosThetaK, phiK);
+      if(!isfinite(exact) || !isfinite(tabulated)) {
+        nNonFinite++;
+        continue;
+      }
+      double dev = fabs(tabulated - exact);
+      maxExact = max(maxExact, exact);
+      sumExact += exact;
+      sumDev += dev;
+      if(dev > maxDev) {
+        maxDev = dev;
+        where[0] = Q2; where[1] = W; where[2] = cosThetaK;
+      }
+    }
+    maxDeviation = maxExact > 0. ? maxDev/maxExact : 0.;
+    meanDeviation = sumExact > 0. ? sumDev/sumExact : 0.;
+  }
+
+  double getMaxDeviation() const { return maxDeviation; }
+  double getMeanDeviation() const { return meanDeviation; }
+  long long getNonFinite() const { return nNonFinite; }
+  const int* getNodes() const { return n; }
+  // the version of the table and its nodes, e.g. v2:81x161x81
+  string name() const {
+    ostringstream s;
+    s << "v" << version << ":" << n[0] << "x" << n[1] << "x" << n[2];
+    return s.str();
+  }
+  size_t bytes() const { return a.size()*sizeof(float); }
+
+  // Write the table with its key (what it was made from, see
+  // evGenerator::tableKey); to a unique temporary name and renamed into
+  // place, so concurrent jobs only see complete files
+  bool write(const string& path, const string& key) const {
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "GENKYTAB", 8);
+    h.version = version;
+    h.byteOrder = byteOrder;
+    for(int k=0; k<3; k++) {
+      h.nodes[k] = n[k];
+      h.lo[k] = lo[k];
+      h.hi[k] = hi[k];
+    }
+    h.keySize = key.size();
+    h.Ebeam = Ebeam;
+    h.threshold = threshold;
+    h.maxDeviation = maxDeviation;
+    h.meanDeviation = meanDeviation;
+    h.nNonFinite = nNonFinite;
+
+    char host[256] = "host";
+    gethostname(host, sizeof(host)-1);
+    ostringstream tmp;
+    tmp << path << ".tmp." << host << "." << getpid();
+    FILE* f = fopen(tmp.str().c_str(), "wb");
+    if(f == NULL) {
+      cerr << " Warning: can not write d5sigma table " << tmp.str() << endl;
+      return false;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    ok = ok && fwrite(key.data(), 1, key.size(), f) == key.size();
+    ok = ok && fwrite(&a[0], sizeof(float), a.size(), f) == a.size();
+    ok = ok && fwrite(&isAbs[0], 1, isAbs.size(), f) == isAbs.size();
+    ok = (fclose(f) == 0) && ok;
+    if(!ok || rename(tmp.str().c_str(), path.c_str()) != 0) {
+      cerr << " Warning: can not write d5sigma table " << path << endl;
+      remove(tmp.str().c_str());
+      return false;
+    }
+    return true;
+  }
+
+  // false (quietly) if there is no table with this key
+  bool read(const string& path, const string& key) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if(f == NULL) return false;
+    Header h;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1
+              && memcmp(h.magic, "GENKYTAB", 8) == 0 && h.version == version
+              && h.byteOrder == byteOrder && h.keySize == key.size()
+              && h.nodes[0] > 1 && h.nodes[1] > 1 && h.nodes[2] > 1;
+    string fileKey(ok ? h.keySize : 0, ' ');
+    ok = ok && fread(&fileKey[0], 1, fileKey.size(), f) == fileKey.size() && fileKey == key;
+    vector<float> values;
+    vector<char> flags;
+    if(ok) {
+      values.resize(3*(size_t)h.nodes[0]*h.nodes[1]*h.nodes[2]);
+      flags.resize((size_t)h.nodes[0]*h.nodes[1]);
+      char extra;
+      ok = fread(&values[0], sizeof(float), values.size(), f) == values.size()
+           && fread(&flags[0], 1, flags.size(), f) == flags.size()
+           && fread(&extra, 1, 1, f) == 0;
+    }
+    fclose(f);
+    if(!ok) return false;
+
+    for(int k=0; k<3; k++) {
+      n[k] = h.nodes[k];
+      lo[k] = h.lo[k];
+      hi[k] = h.hi[k];
+    }
+    Ebeam = h.Ebeam;
+    threshold = h.threshold;
+    maxDeviation = h.maxDeviation;
+    meanDeviation = h.meanDeviation;
+    nNonFinite = h.nNonFinite;
+    setSteps();
+    a.swap(values);
+    isAbs.swap(flags);
+    return true;
+  }
+
+};
+
+#endif
@@ -4,7 +4,11 @@
 #include <vector>
 #include "utils.h"
 #include "kinematics.h"
+#include "gridInterp.h"
+#include "modelFile.h"
 #include <stdexcept>
+#include <thread>
+#include <atomic>
 
 enum channel{
 	KLambda = 0,
@@ -24,12 +28,16 @@ struct f1_params{
 	double W, p0,p1,p2;
 };
 
-double naive_lerp(const double a,const  double b,const  double t)
+struct phi_params{
+	double p0,p1,p2;
+};
+
+double inline naive_lerp(const double a,const  double b,const  double t)
 {
     return a + t * (b - a);
 }
 
-bool check_kin(double Q,double W, double Ebeam)
+bool inline check_kin(double Q,double W, double Ebeam)
 {
  double MP=massProton;
  double OMEGA=(W*W+Q-MP*MP)/(2*MP);
@@ -42,7 +50,7 @@ bool check_kin(double Q,double W, double Ebeam)
  else return 0;
 }
 
-bool check_input_data(string dataPath, string __channelName,double __Ebeam, double __Q2min, double __Q2max, 
+bool inline check_input_data(string dataPath, string __channelName,double __Ebeam, double __Q2min, double __Q2max, 
 						double __Wmin, double __Wmax, int __nEventMax){
  if ((__channelName!="KLambda")&&(__channelName!="KSigma")&&(__channelName!="PiN")&&(__channelName!="Pi0P")){
   cout<<"incorrect name of chanel, pls try: KLambda or KSigma or Pi0P or PiN"<< endl;
@@ -86,13 +94,18 @@ class Sigma{
  int num_str4=0,n_str_Ev=0,num_str3=0,num_str2=0,num_str=0,type_chanel=0,num_costeta=-1,m=0;
 
  int range_fi=-1;//1: -180 +180 2: 0 360
+ bool keepSign=false;//get_d5CS returns a negative interpolation as it is (not its abs)
  int range_cos=-1;//1: == 2: n !=
 ////////////////////////Q2 extrapolation 5-12 GeV2 functions:////////////////////////
 
 /// updated 04/21/2022: ////
 
 		vector<pair<double, vector<CS_at_max_Q2>>> vCSmaxQ2;
+		RectilinearGrid<2,CS_at_max_Q2> CSmaxQ2_grid;// index of vCSmaxQ2 in W and cosTh
 		vector<f1_params> vF1;
+		vector<double> F1_at_Q2max;// F1 of the vF1 nodes at F1_Q2max
+		double F1_Q2max=-1;
+		double norm_Ebeam=-1, norm_Q2max=-1, norm_W=-1, norm_sigma_max=0;// last CS at Q2_max of getCS_fit
 		
 		void read_maxQ2(const string& dataPath, const channel& channelName){
 			const vector<string> files_fitted_cs_at_maxQ2 = {"/KLambda_CS_Qmax_Fit_gladk.txt",
@@ -102,6 +115,7 @@ class Sigma{
 			ifstream f_Q2max;
 			const string filePath = dataPath + files_fitted_cs_at_maxQ2.at(static_cast<int>(channelName));
 			f_Q2max.open(filePath);
+			model_sources.push_back(files_fitted_cs_at_maxQ2.at(static_cast<int>(channelName)).substr(1));
 			
 			if (!f_Q2max.is_open())
 				throw invalid_argument("file is not open: " + filePath);
@@ -169,6 +183,7 @@ class Sigma{
 			ifstream f_f1;
 			const string filePath = dataPath + "/highQ2" + files_f1.at(static_cast<int>(channelName));
 			f_f1.open(filePath);
+			model_sources.push_back("highQ2" + files_f1.at(static_cast<int>(channelName)));
 			
 			if (!f_f1.is_open())
 				throw invalid_argument("file is not open: " + filePath);
@@ -199,38 +214,46 @@ class Sigma{
 		double interpol(const double W, const double cosTh, const double phi){
 		
 			//cout<<W<<' '<< cosTh << ' '<< phi << " type:";
-			// naive temp.func re-do with binary search:
-			for (size_t iW = 0; iW < vCSmaxQ2.size() - 1; iW++){
-				if (W == vCSmaxQ2[iW].first || W == vCSmaxQ2[iW + 1].first){
-					if (W == vCSmaxQ2[iW + 1].first) 
-						iW++;
-					//cout << '1' <<endl;
-					return getCSfromVbyWposAndCosThValue(iW, cosTh, phi);
-				}
-				if ( W > vCSmaxQ2[iW].first && W < vCSmaxQ2[iW + 1].first){
-					//cout << '2' <<endl;
-					// add both W and cos interp
-					double cs_minW = getCSfromVbyWposAndCosThValue(iW, cosTh, phi);
-					double cs_maxW = getCSfromVbyWposAndCosThValue(iW+1, cosTh, phi);
-					double l = (W - vCSmaxQ2[iW].first) / ( vCSmaxQ2[iW + 1].first - vCSmaxQ2[iW].first);
-					return naive_lerp(cs_minW, cs_maxW, l);
-				}	
+			int iW1,iW2;
+			int found=CSmaxQ2_grid.locate(0,0,W,0.,iW1,iW2);
+			if (found==1)
+				return getCSfromVbyWposAndCosThValue(iW1, cosTh, phi);
+			if (found==2){
+				// add both W and cos interp
+				double cs_minW = getCSfromVbyWposAndCosThValue(iW1, cosTh, phi);
+				double cs_maxW = getCSfromVbyWposAndCosThValue(iW2, cosTh, phi);
+				double l = (W - vCSmaxQ2[iW1].first) / ( vCSmaxQ2[iW2].first - vCSmaxQ2[iW1].first);
+				return naive_lerp(cs_minW, cs_maxW, l);
 			}
 			
 			//throw error
 			return 0;
 		};
 		
+		// F1 of the node iF1 of vF1, at Q2_max it is taken from the table
+		double getF1node(const size_t iF1, const double Q2){
+			if (Q2 == F1_Q2max && iF1 < F1_at_Q2max.size())
+				return F1_at_Q2max[iF1];
+			return vF1.at(iF1).p0 + vF1.at(iF1).p1 / Q2 + vF1.at(iF1).p2 / (Q2 *Q2);
+		}
+
+		void setF1_Q2max(const double Q2_max){
+			F1_Q2max = Q2_max;
+			F1_at_Q2max.clear();
+			for (size_t i = 0; i < vF1.size(); i++)
+				F1_at_Q2max.push_back(vF1[i].p0 + vF1[i].p1 / Q2_max + vF1[i].p2 / (Q2_max *Q2_max));
+		}
+
 		double getF1(const double W, const double Q2){
 			//Get F1 at smaller W:
 			int binN_low = (W - vF1.front().W) * (vF1.size() - 1) / (vF1.back().W  - vF1.front().W);
-			double minF1 = vF1.at(binN_low).p0 + vF1.at(binN_low).p1 / Q2 + vF1.at(binN_low).p2 / (Q2 *Q2);
+			double minF1 = getF1node(binN_low, Q2);
 			//cout << (W - vF1.front().W) << ' ' << (vF1.back().W  - vF1.front().W) << ' ' << (vF1.back().W  - vF1.front().W) / (vF1.size() - 1) << " M:" << binN_low << endl;
 			if (binN_low == vF1.size() - 1)
 				return minF1;
 			else{
 				int binN = binN_low + 1;
-				double maxF1 = vF1.at(binN).p0 + vF1.at(binN).p1 / Q2 + vF1.at(binN).p2 / (Q2 * Q2);
+				double maxF1 = getF1node(binN, Q2);
 				double l = (W - vF1.at(binN_low).W) * (vF1.size() - 1) / (vF1.back().W  - vF1.front().W);
 				//cout<<" W:" << W << ' ' <<  minF1 << ' ' << maxF1 << ' ' <<  l << ' ' << binN_low << endl;
 				return naive_lerp(minF1, maxF1, l);
@@ -239,11 +262,17 @@ class Sigma{
 		
 		//legacy name from sigmaValera.h
 		double getCS_fit(const double Ebeam,const  double Q2, const double Q2_max,const double W){
-			//F1 and CS at max data Q2:
-			double sigma_t_max = getF1(W, Q2_max) * 4 * constantPi2 *
-									constantAlpha / (getK(Q2_max,W) * massProton);
-			double sigma_l_max = sigma_t_max * 0.2;
-			double sigma_max = sigma_t_max + getEpsilon(Ebeam,Q2_max,W) * sigma_l_max;
+			//F1 and CS at max data Q2, the same for all calls at this Ebeam and W:
+			if (Ebeam != norm_Ebeam || Q2_max != norm_Q2max || W != norm_W){
+				double sigma_t_max = getF1(W, Q2_max) * 4 * constantPi2 *
+										constantAlpha / (getK(Q2_max,W) * massProton);
+				double sigma_l_max = sigma_t_max * 0.2;
+				norm_sigma_max = sigma_t_max + getEpsilon(Ebeam,Q2_max,W) * sigma_l_max;
+				norm_Ebeam = Ebeam;
+				norm_Q2max = Q2_max;
+				norm_W = W;
+			}
+			double sigma_max = norm_sigma_max;
 			//F1 and CS at current Q2:
 			double sigma_t = getF1(W, Q2) * 4 * constantPi2 *
 									constantAlpha / (getK(Q2,W) * massProton);
@@ -253,27 +282,24 @@ class Sigma{
 		};
 		
 		
-		double getCSfromVbyPos(const size_t iW, const size_t iCosTh, const double phi){
-			return vCSmaxQ2[iW].second[iCosTh].p0 +
-					vCSmaxQ2[iW].second[iCosTh].p1 * cos(2*phi/57.29578049) +
-					vCSmaxQ2[iW].second[iCosTh].p2 * cos(phi/57.29578049);
+		double getCSfromPar(const CS_at_max_Q2& par, const double phi){
+			return par.p0 +
+					par.p1 * cos(2*phi/57.29578049) +
+					par.p2 * cos(phi/57.29578049);
 		}
 		
 		double getCSfromVbyWposAndCosThValue(const size_t iW, const double cosTh, const double phi){
 			//cout<<"ch W:" << vCSmaxQ2[iW].first<<endl;
-			for (size_t iCosTh = 0; iCosTh < vCSmaxQ2[iW].second.size() - 1; iCosTh++){
-			
-				if (cosTh == vCSmaxQ2[iW].second[iCosTh].cosTh || cosTh == vCSmaxQ2[iW].second[iCosTh +1].cosTh){
-					if (cosTh == vCSmaxQ2[iW].second[iCosTh + 1].cosTh) iCosTh++;
-						return getCSfromVbyPos(iW, iCosTh, phi);
-				}
-			
-				// cos intrep
-				if (cosTh > vCSmaxQ2[iW].second[iCosTh].cosTh && cosTh < vCSmaxQ2[iW].second[iCosTh + 1].cosTh){
-					double l = (cosTh - vCSmaxQ2[iW].second[iCosTh].cosTh) / 
-								(vCSmaxQ2[iW].second[iCosTh + 1].cosTh - vCSmaxQ2[iW].second[iCosTh].cosTh);
-					return naive_lerp(getCSfromVbyPos(iW, iCosTh, phi), getCSfromVbyPos(iW, iCosTh + 1, phi), l);
-				}
+			int iCos1,iCos2;
+			int found=CSmaxQ2_grid.locate(1,CSmaxQ2_grid.row(0,iW),cosTh,0.,iCos1,iCos2);
+			if (found==1)
+				return getCSfromPar(CSmaxQ2_grid.at(CSmaxQ2_grid.row(1,iCos1)), phi);
+			// cos intrep
+			if (found==2){
+				double l = (cosTh - CSmaxQ2_grid.node(1,iCos1)) / 
+							(CSmaxQ2_grid.node(1,iCos2) - CSmaxQ2_grid.node(1,iCos1));
+				return naive_lerp(getCSfromPar(CSmaxQ2_grid.at(CSmaxQ2_grid.row(1,iCos1)), phi),
+								getCSfromPar(CSmaxQ2_grid.at(CSmaxQ2_grid.row(1,iCos2)), phi), l);
 			}
 			
 			//throw error
@@ -303,7 +329,10 @@ class Sigma{
  vector<double> _Q2,_W,_cos,_p0,_p1,_p2,param_vec,_Q_int,_W_int,_CS_int;
  vector<double> _CS_ph,_W_ph,W_vec_ph,CS_vec_ph,costeta_vec_ph;
  vector<double> _CS_ph_Ev, _W_ph_Ev;
+ RectilinearGrid<1,double> CS_ph_Ev_grid;// index of _W_ph_Ev
+ RectilinearGrid<2,double> CS_ph_grid;// index of W_vec_ph,costeta_vec_ph -> CS_vec_ph
  vector<double> _W_max,_W_min,_Q_for_ext_point;
+ RectilinearGrid<3,phi_params> CS_grid;// index of _Q2,_W,_cos -> _p0,_p1,_p2
  int is_there_glad=0,num_ext_p=0,n_str_CS=0,n_str_ph=0,n_str_ph_int=0,n_str_CS_int=0,interp_num1=0,interp_num2=0;
  double Qmin=10000,Qmax=0,max_W=0,min_W=10000, max_W_ph=0,min_W_ph=10000,_W_min_all=1000,_W_max_all=0,W_ext_min=1000,W_ext_max=0;
 //photo func main:
@@ -317,10 +346,20 @@ class Sigma{
  double cos_in_ph(int sp, double cos);
 //prepration to work
  void search_exterm_points();
+ void index_tables();
+ vector<string> model_sources;// text files read by the constructor
+ void open_data(ifstream& f, const string& dataPath, const string& name);
+ template <class F> void model_members(F f);
+ bool read_model(const string& dataPath);
 //internal func:
  double lin_interp(double x,double point1, double point2, double value_point1, double value_point2);
  double anti_Fit(double fi, double p0,double p1,double p2, int val);//anti_fit and integr po fi 1-anti_fit, 2-untegr po fi
  double intrep_CS(double Q,double W,double cos,double fi, int type_CS);
+ // nodes of CS_grid around one (Q2, W): what intrep_CS finds before it
+ // interpolates in cos, for the points of the batch d5sigma at that (Q2, W)
+ struct CS_cell{ int nQ, nW[2], row[2][2]; double Q[2], W[2][2]; };
+ bool locate_CS(double Q,double W, CS_cell &cell);
+ double intrep_CS(const CS_cell &cell,double Q,double W,double cos,double fi, int type_CS);
  double W_in(int sp,double W, double cos,double fi, int type);
  double cos_in(int sp, double cos,double fi, int type);
  int check_possibil_inter_W(double Q, double W);
@@ -345,18 +384,26 @@ class Sigma{
  double d5sigma(double beam_energy, double _Q2, double _W, 
   		double thetaK, double phiK);//5-dimens Cross Section, one of the vars is theta
  double dsigma_dcos(double _beam_energy, double _Q2, double _W, double teta);//4-dimens Cross Section
+ void d5sigma_harmonics(double Ebeam, double Q2, double W, double thetaK,
+          double &a0, double &a1, double &a2, bool &isAbs);//d5sigma = a0 + a1*cos(2phiK) + a2*cos(phiK), its abs if isAbs
+ void reduced_harmonics(double Ebeam, double Q2, double W, double cosThetaK,
+          double &a0, double &a1, double &a2, bool &isAbs);//the same for d5sigma/photon flux, without the kinematic limits
+ void d5sigma(double Ebeam, int n, const double* Q2, const double* W,
+          const double* cosThetaK, const double* phiK, double* d5sig);//n points at once, one of the vars is COS(theta)
 
  double int_get_d5CS(double Q,double W, double Ebeam);//3-dimens CS
 
  double d5sigma_max(double Ebeam, double Q2min, double Q2max,
-          double Wmin,  double Wmax  );//max CS in that region
+          double Wmin,  double Wmax, int nThreads=1 );//max CS in that region, scan split over nThreads (0 - all cores)
 ////other:
  double porog_ch(int num_chanel);//threshold of the reaction
- Sigma(string dataPath, int chanel);//constr
+ Sigma(string dataPath, int chanel, bool useModelFile=true);//constr, reads <channel>.model if there is one, else the text tables
+ bool write_model(string dataPath);//binary image of the tables for the constructor (see convertModel.cpp)
+ static string model_path(string dataPath, int chanel);
 	protected:
 };
 ///////////////realization:///////////////////////////////////////////////////////////
-double Sigma::d5sigma(double Ebeam, double Q2, double W, double thetaK, double phiK){
+double inline Sigma::d5sigma(double Ebeam, double Q2, double W, double thetaK, double phiK){
  bool ch=check_kin(Q2,W,Ebeam);
  if (ch==0) { //cout<<"uncorrect input Q and W"<<endl;
   return 0;}
@@ -386,7 +433,106 @@ double Sigma::d5sigma(double Ebeam, double Q2, double W, double thetaK, double p
   return d5sig;
 }
 
-double Sigma::d5sigma2(double Ebeam, double Q2, double W, double costhetaK, double phiK){
+// Every table (and the extrapolation above Q_max_channel) gives the phi
+// dependence as p0 + p1*cos(2phi) + p2*cos(phi), and d5sigma is linear in
+// the tables at fixed (Q2, W, thetaK), so three values fix the harmonics:
+// f(0) = a0+a1+a2, f(pi/2) = a0-a1, f(pi) = a0+a1-a2.
+// Inside the low Q2 tables get_d5CS takes abs() of a negative interpolation
+// (isAbs), elsewhere a negative value is returned as it is, so the harmonics
+// are found from the signed values and d5sigma = |a0 + a1*cos(2phiK) + a2*cos(phiK)|
+// if isAbs, else a0 + a1*cos(2phiK) + a2*cos(phiK).
+void inline Sigma::d5sigma_harmonics(double Ebeam, double Q2, double W, double thetaK,
+                              double &a0, double &a1, double &a2, bool &isAbs){
+ isAbs=(Q2<Q_max_channel)&&(check_possibil_inter_Q2(Q2)==0)&&(check_possibil_inter_W(Q2,W)==0);
+ keepSign=true;
+ double f0  = d5sigma(Ebeam, Q2, W, thetaK, 0.);
+ double f90 = d5sigma(Ebeam, Q2, W, thetaK, constantPi/2.);
+ double f180= d5sigma(Ebeam, Q2, W, thetaK, constantPi);
+ keepSign=false;
+ a2 = (f0-f180)/2.;
+ a0 = ((f0+f180)/2.+f90)/2.;
+ a1 = ((f0+f180)/2.-f90)/2.;
+}
+
+// The harmonics of d5sigma without the photon flux: the interpolation of
+// the tables (or the extrapolation above Q_max_channel) alone, found from
+// phi = 0, 90 and 180 degrees as in d5sigma_harmonics. The kinematic
+// limits of d5sigma are not checked, the caller multiplies by the flux.
+// isAbs: (Q2, W) is inside the low Q2 tables, where get_d5CS returns the
+// abs of a negative interpolation; elsewhere a negative value is returned
+// as it is.
+void inline Sigma::reduced_harmonics(double Ebeam, double Q2, double W, double cosThetaK,
+                              double &a0, double &a1, double &a2, bool &isAbs){
+ isAbs=(Q2<Q_max_channel)&&(check_possibil_inter_Q2(Q2)==0)&&(check_possibil_inter_W(Q2,W)==0);
+ keepSign=true;
+ double f[3];
+ for (int i=0;i<3;i++){
+  double fi=i*(constantPi/2.)*57.2957;
+  f[i]=(Q2<Q_max_channel) ? get_d5CS(Q2, W, cosThetaK, fi, Ebeam) : get_CS(Q2, W, cosThetaK, fi, Ebeam);
+ }
+ keepSign=false;
+ a2 = (f[0]-f[2])/2.;
+ a0 = ((f[0]+f[2])/2.+f[1])/2.;
+ a1 = ((f[0]+f[2])/2.-f[1])/2.;
+}
+
+// n points given as arrays: d5sig[i] = d5sigma(Ebeam, Q2[i], W[i], acos(cosThetaK[i]), phiK[i]).
+// The kinematic limits and the photon flux of all points are found in one
+// loop without branches (it vectorizes). Inside the low Q2 tables the nodes
+// around a (Q2, W) are found once for a run of points with that (Q2, W),
+// which then only interpolate in cos and phi, so a scan should give the
+// points of one (Q2, W) one after another; everything else goes through
+// get_d5CS and get_CS as in d5sigma.
+// cosThetaK is used as it is given (d5sigma takes cos(acos(cosThetaK))),
+// the two agree to 1e-10 relative (exactly for the same cos).
+void inline Sigma::d5sigma(double Ebeam, int n, const double* Q2, const double* W,
+                    const double* cosThetaK, const double* phiK, double* d5sig){
+ const double mp=massProton;
+ const double mp2=massProton2;
+ const double W_threshold=porog_ch(type_chanel);
+ const double sinMax=sin(3.1415927/4);// 2*asin(sinus) <= 3.1415927/2 of check_kin
+ for (int i=0;i<n;i++){
+  double Q=Q2[i], W2=W[i]*W[i];
+  double omega=(W2+Q-mp2)/(2*mp);
+  double EE2=Ebeam*(Ebeam-omega);
+  double sinus=sqrt(Q/(4*EE2));
+  double arg=1.-Q/(2.*EE2);
+  bool ok=(Q/(4*EE2)<=1)&&(2-Q/(2*EE2)>0)&&(-Q/(2*EE2)<=0)&&(omega>=0)&&(Ebeam-omega>=0)&&(sinus<=sinMax)
+        &&(W[i]>=W_threshold)&&(Q>=0.0001)&&(Q<=30)&&(W[i]<=5)&&(phiK[i]>=0)&&(phiK[i]<=6.284)
+        &&(arg<=1.)&&(arg>=-1.);
+  double epsilon=1./(1.+(2.*(Q+omega*omega))/(4.*Ebeam*(Ebeam-omega)-Q));
+  double gamma=(constantAlpha/(2.*constantPi2))*((Ebeam-omega)/Ebeam)*(W2-mp2)/(2.*mp*Q)*(1./(1.-epsilon));
+  d5sig[i]=ok ? gamma : 0.;
+ }
+
+ CS_cell cell{};
+ for (int j=0,last;j<n;j=last){
+  // the points j..last-1 have the same (Q2, W)
+  last=j+1;
+  while (last<n && Q2[last]==Q2[j] && W[last]==W[j]) last++;
+  double Q=Q2[j], w=W[j];
+  // the first case of get_d5CS
+  bool isGrid=(Q<Q_max_channel)&&(check_possibil_inter_Q2(Q)==0)&&(check_possibil_inter_W(Q,w)==0)
+            &&locate_CS(Q,w,cell);
+  for (int i=j;i<last;i++){
+   if (d5sig[i]==0.) continue;
+   double fi=phiK[i]*57.2957;
+   if (isGrid){
+    if (range_fi==1){
+     fi=fi-180;
+     if (abs(fi+180)<0.001) {fi=-179.9999;}
+     if (abs(fi-180)<0.001) {fi=179.9999;}
+    }
+    double tmp_res=intrep_CS(cell,Q,w,cosThetaK[i],fi,1);
+    d5sig[i]*=(tmp_res>=0 || keepSign) ? tmp_res : abs(tmp_res);
+   }
+   else if (Q<Q_max_channel) d5sig[i]*=this->get_d5CS(Q, w, cosThetaK[i], fi, Ebeam);
+   else d5sig[i]*=this->get_CS(Q, w, cosThetaK[i], fi, Ebeam);
+  }
+ }
+}
+
+double inline Sigma::d5sigma2(double Ebeam, double Q2, double W, double costhetaK, double phiK){
  bool ch=check_kin(Q2,W,Ebeam);
  if (ch==0) { //cout<<"uncorrect input Q and W"<<endl;
   return 0;}
@@ -421,8 +567,8 @@ double Sigma::d5sigma2(double Ebeam, double Q2, double W, double costhetaK, doub
   return d5sig;
 }
 
-double Sigma::d5sigma_max(double Ebeam, double Q2min, double Q2max,
-                                       double Wmin,  double Wmax  )
+double inline Sigma::d5sigma_max(double Ebeam, double Q2min, double Q2max,
+                                       double Wmin,  double Wmax, int nThreads )
 {
         double pi=constantPi;
 
@@ -435,27 +581,54 @@ double Sigma::d5sigma_max(double Ebeam, double Q2min, double Q2max,
 	double d5sigmaMax=0.;
 
 Q2max=Q2max-(Q2max-Q2min)/2;
-        for(int iQ2=0; iQ2<nQ2; iQ2++) {
-	double Q2 = Q2min + (Q2max-Q2min)*iQ2/(nQ2-1);
-	cout<<"Find maximum of the cross section: "<<100*iQ2/nQ2<<"%"<<endl;
-        for(int iW=0;   iW<nW;  iW++) {
-	double W =  Wmin +  (Wmax-Wmin)*iW/(nW-1);
+
+	// The scan is split into (Q2, W) rows that the workers take in turn.
+	// Every worker has its own copy of the model (the interpolation keeps
+	// state in the object), the maximum is reduced over the rows, so the
+	// result does not depend on the number of threads.
+	int nRows=nQ2*nW;
+	if (nThreads<=0) nThreads=thread::hardware_concurrency();
+	if (nThreads<=0) nThreads=1;
+	if (nThreads>nRows) nThreads=nRows;
+	cout<<"Find maximum of the cross section: "<<nThreads<<" thread(s)"<<endl;
+
+	// the cos of a row are cos(acos(cosThetaK)) as d5sigma takes them,
+	// so the batch d5sigma gives the same values as point by point
+	int nPoints=nCosThetaK*nPhiK;
+	vector<double> cosPoint(nPoints),phiPoint(nPoints);
 	for(int iCosThK=0; iCosThK<nCosThetaK; iCosThK++) {
-	//double cosThetaK=0;
 	double cosThetaK = -0.9999 + (0.9999-(-0.9999))*iCosThK/(nCosThetaK-1);
-	//cout<<"costeta="<<cosThetaK<<endl;
 	double thetaK = acos(cosThetaK);
         for(int iPhiK=0; iPhiK<nPhiK;  iPhiK++) {
-	double phiK = 0. + (2.*pi-0.)*iPhiK/(nPhiK-1);
-	//cout<<" Ebeam="<<Ebeam<<" Q2="<<Q2<<" W="<<W<<" thetaK="<<thetaK<<" cosThetaK: "<<cosThetaK<<" phiK="<<phiK<<endl; 
-          double d5sig = d5sigma(Ebeam, Q2, W, thetaK, phiK);
-		//cout<<"d5sig: "<<d5sig<<endl;
-          if(d5sig>d5sigmaMax) d5sigmaMax=d5sig;
-    
+	cosPoint[iCosThK*nPhiK+iPhiK] = cos(thetaK);
+	phiPoint[iCosThK*nPhiK+iPhiK] = 0. + (2.*pi-0.)*iPhiK/(nPhiK-1);
 	}
-        }
 	}
-        }
+
+	vector<double> rowMax(nRows,0.);
+	atomic<int> nextRow(0);
+	auto scanRows=[&](Sigma *s){
+	vector<double> Q2Point(nPoints),WPoint(nPoints),d5sig(nPoints);
+	for(int row=nextRow++; row<nRows; row=nextRow++) {
+	int iQ2=row/nW;
+	int iW=row%nW;
+	double Q2 = Q2min + (Q2max-Q2min)*iQ2/(nQ2-1);
+	if (iW==0 && nThreads==1) cout<<"Find maximum of the cross section: "<<100*iQ2/nQ2<<"%"<<endl;
+	double W =  Wmin +  (Wmax-Wmin)*iW/(nW-1);
+	fill(Q2Point.begin(),Q2Point.end(),Q2);
+	fill(WPoint.begin(),WPoint.end(),W);
+	s->d5sigma(Ebeam, nPoints, &Q2Point[0], &WPoint[0], &cosPoint[0], &phiPoint[0], &d5sig[0]);
+	for(int i=0; i<nPoints; i++) if(d5sig[i]>rowMax[row]) rowMax[row]=d5sig[i];
+	}
+	};
+
+	vector<Sigma> copies(nThreads-1,*this);
+	vector<thread> workers;
+	for(int i=0;i<nThreads-1;i++) workers.push_back(thread(scanRows,&copies[i]));
+	scanRows(this);
+	for(int i=0;i<nThreads-1;i++) workers[i].join();
+
+	for(int row=0;row<nRows;row++) if(rowMax[row]>d5sigmaMax) d5sigmaMax=rowMax[row];
 
 if (d5sigmaMax==0){cout<<"incorrect kinematic region, pls check input Q2 and Energy"<<endl;}
 	cout<<"Find maximum of the cross section: "<<"complete"<<endl;
@@ -693,7 +866,7 @@ if (d5sigmaMax==0){cout<<"incorrect kinematic region, pls check input Q2 and Ene
 			return CS_int_fi_costeta;
 		}
 
-		Sigma::Sigma(string dataPath, int chanel)
+		Sigma::Sigma(string dataPath, int chanel, bool useModelFile)
 		{
 			ifstream interp_right;
 			ifstream file_F1;
@@ -707,6 +880,7 @@ if (d5sigmaMax==0){cout<<"incorrect kinematic region, pls check input Q2 and Ene
 			ifstream data_error;
 
 			type_chanel=chanel;
+			if (useModelFile && read_model(dataPath)) return;
 //cout<<"000000000000000000000";
 			switch (chanel)
 			{
@@ -716,17 +890,17 @@ if (d5sigmaMax==0){cout<<"incorrect kinematic region, pls check input Q2 and Ene
 					min_cos=-0.7749999;
 					range_fi=1;range_cos=1; 
 
-					interp_right.open(dataPath+"/KL_interp.txt");
+					open_data(interp_right,dataPath,"KL_interp.txt");
 					if (!interp_right.is_open()) cout<<"ERROR: wrong way to the data, pls check eg_config_test.txt";
-					file_F1.open(dataPath+"/KLambda_Fit_F1.txt");
+					open_data(file_F1,dataPath,"KLambda_Fit_F1.txt");
 					file_F2.open(dataPath+"/KLambda_Fit_F2.txt");
-					file_Qmax.open(dataPath+"/KLambda_CS_Qmax_Fit_gladk.txt");
+					open_data(file_Qmax,dataPath,"KLambda_CS_Qmax_Fit_gladk.txt");
 
-					CS_data.open(dataPath+"/KL_s4.txt");
-					CS_data_int.open(dataPath+"/CS_PiN_int.txt");//ISPRAVIT!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-					file_low_photo_data.open(dataPath+"/KL_ph_out.txt");
-					file_ph_int.open(dataPath+"/KL_ph_int.txt");
-					from_Evgen.open(dataPath+"/KL_ph_int.txt");
+					open_data(CS_data,dataPath,"KL_s4.txt");
+					open_data(CS_data_int,dataPath,"CS_PiN_int.txt");//ISPRAVIT!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+					open_data(file_low_photo_data,dataPath,"KL_ph_out.txt");
+					open_data(file_ph_int,dataPath,"KL_ph_int.txt");
+					open_data(from_Evgen,dataPath,"KL_ph_int.txt");
 
 				}break;
 				case 2:{ 
@@ -735,17 +909,17 @@ if (d5sigmaMax==0){cout<<"incorrect kinematic region, pls check input Q2 and Ene
 					min_cos=-0.7749999;
 					range_fi=1;range_cos=1; 
 
-					interp_right.open(dataPath+"/KS_interp.txt");
+					open_data(interp_right,dataPath,"KS_interp.txt");
 					if (!interp_right.is_open()) cout<<"ERROR: wrong way to the data, pls check eg_config_test.txt";
-					file_F1.open(dataPath+"/KSigma_Fit_F1.txt");
+					open_data(file_F1,dataPath,"KSigma_Fit_F1.txt");
 					file_F2.open(dataPath+"/KSigma_Fit_F2.txt");
-					file_Qmax.open(dataPath+"/KSigma_CS_Qmax_Fit_gladk.txt");
+					open_data(file_Qmax,dataPath,"KSigma_CS_Qmax_Fit_gladk.txt");
 
-					CS_data.open(dataPath+"/KS_s4.txt");
-					CS_data_int.open(dataPath+"/CS_PiN_int.txt");//ISPRAVIT!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-					file_low_photo_data.open(dataPath+"/KS_ph_out_new.txt");
-					file_ph_int.open(dataPath+"/KS_ph_int_new.txt");
-					from_Evgen.open(dataPath+"/KS_ph_int_new.txt");
+					open_data(CS_data,dataPath,"KS_s4.txt");
+					open_data(CS_data_int,dataPath,"CS_PiN_int.txt");//ISPRAVIT!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+					open_data(file_low_photo_data,dataPath,"KS_ph_out_new.txt");
+					open_data(file_ph_int,dataPath,"KS_ph_int_new.txt");
+					open_data(from_Evgen,dataPath,"KS_ph_int_new.txt");
 					data_error.open(dataPath+"/CSKS_Theory.txt");
 				}break;
 				case 3:{ 
@@ -753,34 +927,34 @@ if (d5sigmaMax==0){cout<<"incorrect kinematic region, pls check input Q2 and Ene
    					range_fi=2;range_cos=1; 
 					max_cos=0.89999;
 					min_cos=-0.89999;
-					interp_right.open(dataPath+"/Pi0P_interp.txt");
+					open_data(interp_right,dataPath,"Pi0P_interp.txt");
 					if (!interp_right.is_open()) cout<<"ERROR: wrong way to the data, pls check eg_config_test.txt";
-					file_F1.open(dataPath+"/Pi0P_Fit_F1.txt");
+					open_data(file_F1,dataPath,"Pi0P_Fit_F1.txt");
 					file_F2.open(dataPath+"/Pi0P_Fit_F2.txt");
-					file_Qmax.open(dataPath+"/Pi0P_CS_Qmax_Fit_gladk.txt");
+					open_data(file_Qmax,dataPath,"Pi0P_CS_Qmax_Fit_gladk.txt");
 
-					CS_data.open(dataPath+"/CS_pi0p.txt");
-					CS_data_int.open(dataPath+"/CS_PiN_int.txt");//ISPRAVIT!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-					file_low_photo_data.open(dataPath+"/pi0p_ph_out.txt");
-					file_ph_int.open(dataPath+"/pi0p_ph_int.txt");
-					from_Evgen.open(dataPath+"/pi0p.data");
+					open_data(CS_data,dataPath,"CS_pi0p.txt");
+					open_data(CS_data_int,dataPath,"CS_PiN_int.txt");//ISPRAVIT!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+					open_data(file_low_photo_data,dataPath,"pi0p_ph_out.txt");
+					open_data(file_ph_int,dataPath,"pi0p_ph_int.txt");
+					open_data(from_Evgen,dataPath,"pi0p.data");
 				}break;
 				case 4:{ 
 					Q_max_channel=4.16;
 					range_fi=2;range_cos=2; 
 					max_cos=0.899999;
 					min_cos=-0.699999;
-					interp_right.open(dataPath+"/PiN_interp.txt");
+					open_data(interp_right,dataPath,"PiN_interp.txt");
 					if (!interp_right.is_open()) cout<<"ERROR: wrong way to the data, pls check eg_config_test.txt";
-					file_F1.open(dataPath+"/PiN_Fit_F1.txt");
+					open_data(file_F1,dataPath,"PiN_Fit_F1.txt");
 					file_F2.open(dataPath+"/PiN_Fit_F2.txt");
-					file_Qmax.open(dataPath+"/PiN_CS_Qmax_Fit_gladk.txt");
+					open_data(file_Qmax,dataPath,"PiN_CS_Qmax_Fit_gladk.txt");
 
-					CS_data.open(dataPath+"/CS_PiN.txt");
-					CS_data_int.open(dataPath+"/CS_PiN_int.txt");
-					file_low_photo_data.open(dataPath+"/piN_ph_out.txt");
-					file_ph_int.open(dataPath+"/piN_ph_int_out.txt");
-					from_Evgen.open(dataPath+"/pipn.data");
+					open_data(CS_data,dataPath,"CS_PiN.txt");
+					open_data(CS_data_int,dataPath,"CS_PiN_int.txt");
+					open_data(file_low_photo_data,dataPath,"piN_ph_out.txt");
+					open_data(file_ph_int,dataPath,"piN_ph_int_out.txt");
+					open_data(from_Evgen,dataPath,"pipn.data");
 
 				}break;
 				defult:{ 
@@ -1100,9 +1274,6 @@ if (d5sigmaMax==0){cout<<"incorrect kinematic region, pls check input Q2 and Ene
 
 			chislo=-1;
 
-			search_exterm_points();
-			num_ext_p=_Q_for_ext_point.size();
-
 			//getline(file_low_photo_data, str01);
 			//getline(file_low_photo_data, str01);
 			chislo=-1;
@@ -1220,6 +1391,7 @@ if (d5sigmaMax==0){cout<<"incorrect kinematic region, pls check input Q2 and Ene
 			read_maxQ2(dataPath, channelName);
 			read_StrFunF1(dataPath, channelName);
 			////
+			index_tables();
 		
 		}
 		double Sigma::check_cos(double costeta,double W){
@@ -1228,7 +1400,7 @@ if (d5sigmaMax==0){cout<<"incorrect kinematic region, pls check input Q2 and Ene
 			return costeta;
 		}
 
-double Sigma::porog_ch(int num_chanel){//1-KL 2-KS 3-Pi0P 4-PiN
+double inline Sigma::porog_ch(int num_chanel){//1-KL 2-KS 3-Pi0P 4-PiN
 	switch (num_chanel)
 	{
 		case 1: return massLambda+massKaon; break;
@@ -1240,11 +1412,11 @@ double Sigma::porog_ch(int num_chanel){//1-KL 2-KS 3-Pi0P 4-PiN
 	return 0;
 }
 
-double  Sigma::getK(double Q2, double W){
+double inline Sigma::getK(double Q2, double W){
 	return (2*getomega(Q2,W)*massProton-Q2)/(2*massProton);
 }
 
-double Sigma::fun_points(double Q, double W, const vector<double>& Q_F1, const vector<double>& W_F1, const vector<double>& F1_F1,int num_str){
+double inline Sigma::fun_points(double Q, double W, const vector<double>& Q_F1, const vector<double>& W_F1, const vector<double>& F1_F1,int num_str){
 	double start_point_Q=-1;
 	int num_interp=2,only_one=0;
 
@@ -1334,7 +1506,7 @@ double Sigma::fun_points(double Q, double W, const vector<double>& Q_F1, const v
 	return 0;
 
 }
-double Sigma::lineal_interp_1(double x_r, const vector<double>& x,const vector<double>& y,int num_str){
+double inline Sigma::lineal_interp_1(double x_r, const vector<double>& x,const vector<double>& y,int num_str){
 	int start_point_x=-1;
 
 	for (int i=0;i<num_str;i++)
@@ -1350,7 +1522,7 @@ double Sigma::lineal_interp_1(double x_r, const vector<double>& x,const vector<d
 	return 0;
 }
 /*
-double Sigma::interpol(double Q, double W, double fi, const vector<double>& Q_F1, const vector<double>& W_F1,
+double inline Sigma::interpol(double Q, double W, double fi, const vector<double>& Q_F1, const vector<double>& W_F1,
 			 const vector<double>& p0_Qmax, const vector<double>& p1_Qmax, const vector<double>& p2_Qmax,double num_str)
 	{
 		double start_point_Q=-1;
@@ -1464,7 +1636,7 @@ double Sigma::interpol(double Q, double W, double fi, const vector<double>& Q_F1
 	}
 */
 /*
-double Sigma::getCS_fit(double Ebeam, double Q, double Qmax,double W, 
+double inline Sigma::getCS_fit(double Ebeam, double Q, double Qmax,double W, 
 			const vector<double>& Q_F1, const vector<double>& W_F1, const vector<double>& F1_F1,double num_str)
 			//,vector<double> Q_F2, vector<double> W_F2, vector<double> F2_F2,double num_str2)
 	{
@@ -1516,14 +1688,144 @@ double Sigma::getCS_fit(double Ebeam, double Q, double Qmax,double W,
 			return a;
 		}
 
-double Sigma::dsigma_dcos(double _beam_energy, double _Q2, double _W, double costeta){
+double inline Sigma::dsigma_dcos(double _beam_energy, double _Q2, double _W, double costeta){
  double cache1=0;
  for (double fi=0.05;fi<=6.28;fi+=0.1) {cache1+=0.1*d5sigma2(_beam_energy,_Q2,_W,costeta,fi)/getGamma(_beam_energy, _Q2, _W);}
  //cout<<"Q: "<<_Q2<<" W: "<<_W<<" cos: "<<costeta<<"D_cos: "<<cache1<<endl;
  return cache1;
 }
 
-void Sigma::search_exterm_points(){
+void inline Sigma::open_data(ifstream& f, const string& dataPath, const string& name){
+	f.open(dataPath+"/"+name);
+	model_sources.push_back(name);
+}
+
+// Everything the text tables give; the rest (indexes, extreme points) is
+// made from it by index_tables().
+template <class F> void Sigma::model_members(F f){
+	f("Q_Qmax",Q_Qmax); f("W_Qmax",W_Qmax); f("costeta_Qmax",costeta_Qmax);
+	f("p0_Qmax",p0_Qmax); f("p1_Qmax",p1_Qmax); f("p2_Qmax",p2_Qmax); f("param",param);
+	f("Q_F1",Q_F1); f("W_F1",W_F1); f("F1_F1",F1_F1);
+	f("CS_inter",CS_inter); f("W_inter",W_inter); f("costeta_Qmax_int",costeta_Qmax_int);
+	f("_Q2",_Q2); f("_W",_W); f("_cos",_cos); f("_p0",_p0); f("_p1",_p1); f("_p2",_p2);
+	f("param_vec",param_vec); f("_Q_int",_Q_int); f("_W_int",_W_int); f("_CS_int",_CS_int);
+	f("_CS_ph",_CS_ph); f("_W_ph",_W_ph);
+	f("W_vec_ph",W_vec_ph); f("CS_vec_ph",CS_vec_ph); f("costeta_vec_ph",costeta_vec_ph);
+	f("_CS_ph_Ev",_CS_ph_Ev); f("_W_ph_Ev",_W_ph_Ev);
+
+	f("max_W_F1",max_W_F1); f("Q_max_channel",Q_max_channel); f("max_W_Qmax",max_W_Qmax);
+	f("max_W_inter",max_W_inter); f("min_W_inter",min_W_inter); f("min_W_F1",min_W_F1);
+	f("min_W_Qmax",min_W_Qmax); f("ph_fac",ph_fac); f("max_cos",max_cos); f("min_cos",min_cos);
+	f("num_str4",num_str4); f("n_str_Ev",n_str_Ev); f("num_str3",num_str3); f("num_str2",num_str2);
+	f("num_str",num_str); f("num_costeta",num_costeta); f("m",m);
+	f("range_fi",range_fi); f("range_cos",range_cos); f("is_there_glad",is_there_glad);
+	f("n_str_CS",n_str_CS); f("n_str_ph",n_str_ph); f("n_str_ph_int",n_str_ph_int); f("n_str_CS_int",n_str_CS_int);
+	f("Qmin",Qmin); f("Qmax",Qmax); f("max_W",max_W); f("min_W",min_W);
+	f("max_W_ph",max_W_ph); f("min_W_ph",min_W_ph);
+}
+
+string inline Sigma::model_path(string dataPath, int chanel){
+	const char* names[4]={"KLambda","KSigma","Pi0P","PiN"};
+	if (chanel<1||chanel>4) return "";
+	return dataPath+"/"+names[chanel-1]+".model";
+}
+
+bool inline Sigma::write_model(string dataPath){
+	ModelFile model;
+	model_members([&](const char* name, auto& x){ model.add(name,x); });
+
+	vector<double> W,n,Q2,BeamEner,cosTh,p0,p1,p2,cr1,cr2;
+	for (size_t iW=0;iW<vCSmaxQ2.size();iW++){
+		W.push_back(vCSmaxQ2[iW].first);
+		n.push_back(vCSmaxQ2[iW].second.size());
+		for (const CS_at_max_Q2& c : vCSmaxQ2[iW].second){
+			Q2.push_back(c.Q2); BeamEner.push_back(c.BeamEner); cosTh.push_back(c.cosTh);
+			p0.push_back(c.p0); p1.push_back(c.p1); p2.push_back(c.p2);
+			cr1.push_back(c.cr1); cr2.push_back(c.cr2);
+		}
+	}
+	model.add("maxQ2_W",W); model.add("maxQ2_n",n); model.add("maxQ2_Q2",Q2);
+	model.add("maxQ2_BeamEner",BeamEner); model.add("maxQ2_cosTh",cosTh);
+	model.add("maxQ2_p0",p0); model.add("maxQ2_p1",p1); model.add("maxQ2_p2",p2);
+	model.add("maxQ2_cr1",cr1); model.add("maxQ2_cr2",cr2);
+
+	vector<double> F1_W,F1_p0,F1_p1,F1_p2;
+	for (const f1_params& f : vF1){
+		F1_W.push_back(f.W); F1_p0.push_back(f.p0); F1_p1.push_back(f.p1); F1_p2.push_back(f.p2);
+	}
+	model.add("F1_W",F1_W); model.add("F1_p0",F1_p0); model.add("F1_p1",F1_p1); model.add("F1_p2",F1_p2);
+
+	return model.write(model_path(dataPath,type_chanel),type_chanel,dataPath,model_sources);
+}
+
+bool inline Sigma::read_model(const string& dataPath){
+	ModelFile model;
+	string path=model_path(dataPath,type_chanel);
+	if (!model.open(path,type_chanel,dataPath)) return false;
+
+	// check first: a model file that misses a table must leave the object
+	// untouched for the text tables
+	bool ok=true;
+	model_members([&](const char* name, auto& x){ ok = ok && model.has(name,x); });
+	const char* arrays[]={"maxQ2_W","maxQ2_n","maxQ2_Q2","maxQ2_BeamEner","maxQ2_cosTh","maxQ2_p0",
+		"maxQ2_p1","maxQ2_p2","maxQ2_cr1","maxQ2_cr2","F1_W","F1_p0","F1_p1","F1_p2"};
+	for (const char* name : arrays) ok = ok && model.find(name)>=0;
+	if (!ok){
+		cout<<" Model file "<<path<<" misses tables, reading the text tables"<<endl;
+		return false;
+	}
+	model_members([&](const char* name, auto& x){ model.get(name,x); });
+
+	vector<double> W,n,Q2,BeamEner,cosTh,p0,p1,p2,cr1,cr2;
+	model.get("maxQ2_W",W); model.get("maxQ2_n",n); model.get("maxQ2_Q2",Q2);
+	model.get("maxQ2_BeamEner",BeamEner); model.get("maxQ2_cosTh",cosTh);
+	model.get("maxQ2_p0",p0); model.get("maxQ2_p1",p1); model.get("maxQ2_p2",p2);
+	model.get("maxQ2_cr1",cr1); model.get("maxQ2_cr2",cr2);
+	for (size_t iW=0,i=0;iW<W.size()&&iW<n.size();iW++){
+		vector<CS_at_max_Q2> row;
+		for (int j=0;j<(int)n[iW]&&i<Q2.size();j++,i++)
+			row.push_back({Q2[i],BeamEner[i],cosTh[i],p0[i],p1[i],p2[i],cr1[i],cr2[i]});
+		vCSmaxQ2.push_back({W[iW],row});
+	}
+
+	vector<double> F1_W,F1_p0,F1_p1,F1_p2;
+	model.get("F1_W",F1_W); model.get("F1_p0",F1_p0); model.get("F1_p1",F1_p1); model.get("F1_p2",F1_p2);
+	for (size_t i=0;i<F1_W.size();i++) vF1.push_back({F1_W[i],F1_p0[i],F1_p1[i],F1_p2[i]});
+
+	index_tables();
+	return true;
+}
+
+// indexes of the tables, the same for the text tables and the model file
+void inline Sigma::index_tables(){
+	for (int i=0;i<n_str_CS;i++){
+		double node[3]={_Q2[i],_W[i],_cos[i]};
+		phi_params par={_p0[i],_p1[i],_p2[i]};
+		CS_grid.addRow(node,par);
+	}
+	CS_grid.build();
+	search_exterm_points();
+	num_ext_p=_Q_for_ext_point.size();
+
+	for (int i=0;i<n_str_Ev;i++) CS_ph_Ev_grid.addRow(&_W_ph_Ev[i],_CS_ph_Ev[i]);
+	CS_ph_Ev_grid.build();
+
+	for (int i=0;i<n_str_ph;i++){
+		double node[2]={W_vec_ph[i],costeta_vec_ph[i]};
+		CS_ph_grid.addRow(node,CS_vec_ph[i]);
+	}
+	CS_ph_grid.build();
+
+	for (size_t iW = 0; iW < vCSmaxQ2.size(); iW++)
+		for (size_t iCosTh = 0; iCosTh < vCSmaxQ2[iW].second.size(); iCosTh++){
+			double node[2] = {vCSmaxQ2[iW].first, vCSmaxQ2[iW].second[iCosTh].cosTh};
+			CSmaxQ2_grid.addRow(node, vCSmaxQ2[iW].second[iCosTh]);
+		}
+	CSmaxQ2_grid.build();
+	setF1_Q2max(Q_Qmax[2]);
+}
+
+void inline Sigma::search_exterm_points(){
 	double W_st1=1000,W_st2=0,Q2_st=_Q2[0];
 	for (int i=0;i<n_str_CS;i++){
 		if (_Q2[i]==Q2_st){
@@ -1557,56 +1859,55 @@ void Sigma::search_exterm_points(){
 
 }
 
-int Sigma::check_possibil_inter_Q2(double Q){
+int inline Sigma::check_possibil_inter_Q2(double Q){
 	if (Q<Qmin) return 1;
 	if (Q>Qmax) return 2;
 	return 0;
 }
-double Sigma::change_Q2(double Q){
+double inline Sigma::change_Q2(double Q){
 	if (Q<Qmin) return Qmin;
 	if (Q>Qmax) cout<<" ERROR it large Q2"<<endl;
 	return Q;
 }
 
-int Sigma::check_possibil_inter_W(double Q, double W){
-
-	for (int i=0;i<num_ext_p;i++){
-		if(Q==_Q_for_ext_point[i]){
-			interp_num1=i;
-			interp_num2=i;
-			if (W>W_ext_max) return 8;// all data have alredy used
-			if (W<W_ext_min) return 7;// all data have alredy used
-			if ((W<=W_ext_max)&&(W>_W_max_all)) return 6;// one point exterp
-			if ((W>=W_ext_min)&&(W<_W_min_all)) return 5;// one point exterp
-			//if ((W>_W_max[i])||(W>_W_max_all)) return 4;
-			//if ((W<_W_min[i])||(W<_W_min_all)) return 3;
-			if (W>=_W_min_all) return 0;
-			if (W<=_W_max_all) return 0;
-		}
-		if((Q>_Q_for_ext_point[i])&&(Q<_Q_for_ext_point[i+1])){
-			interp_num1=i;
-			interp_num2=i+1;
-			if (W>W_ext_max) return 8;// all data have alredy used
-			if (W<W_ext_min) return 7;// all data have alredy used
-			if ((W<=W_ext_max)&&(W>_W_max_all)) return 6;// one point exterp
-			if ((W>=W_ext_min)&&(W<_W_min_all)) return 5;// one point exterp
-			//if ((W>_W_max[i])||(W>_W_max[i+1])||(W>_W_max_all)) return 4;
-			//if ((W<_W_min[i])||(W<_W_min[i+1])||(W<_W_min_all)) return 3;
-			if ((W<=_W_max[i])&&(W<=_W_max[i+1])&&(W<=_W_max_all)) return 0;
-			if ((W>=_W_min[i])&&(W>=_W_min[i+1])&&(W>=_W_min_all)) return 0;
-		}
+int inline Sigma::check_possibil_inter_W(double Q, double W){
+	int i,i2;
+	int found=CS_grid.locate(0,0,Q,0.,i,i2);// nodes of Q2 are _Q_for_ext_point
+	if(found==1){
+		interp_num1=i;
+		interp_num2=i;
+		if (W>W_ext_max) return 8;// all data have alredy used
+		if (W<W_ext_min) return 7;// all data have alredy used
+		if ((W<=W_ext_max)&&(W>_W_max_all)) return 6;// one point exterp
+		if ((W>=W_ext_min)&&(W<_W_min_all)) return 5;// one point exterp
+		//if ((W>_W_max[i])||(W>_W_max_all)) return 4;
+		//if ((W<_W_min[i])||(W<_W_min_all)) return 3;
+		if (W>=_W_min_all) return 0;
+		if (W<=_W_max_all) return 0;
+	}
+	if(found==2){
+		interp_num1=i;
+		interp_num2=i+1;
+		if (W>W_ext_max) return 8;// all data have alredy used
+		if (W<W_ext_min) return 7;// all data have alredy used
+		if ((W<=W_ext_max)&&(W>_W_max_all)) return 6;// one point exterp
+		if ((W>=W_ext_min)&&(W<_W_min_all)) return 5;// one point exterp
+		//if ((W>_W_max[i])||(W>_W_max[i+1])||(W>_W_max_all)) return 4;
+		//if ((W<_W_min[i])||(W<_W_min[i+1])||(W<_W_min_all)) return 3;
+		if ((W<=_W_max[i])&&(W<=_W_max[i+1])&&(W<=_W_max_all)) return 0;
+		if ((W>=_W_min[i])&&(W>=_W_min[i+1])&&(W>=_W_min_all)) return 0;
 	}
 cout<<" ERROR check_possibil_inter_W"<<endl;
 return -1;
 }
 
-int Sigma::range_ph(double W){
+int inline Sigma::range_ph(double W){
 	//cout<<" min_W_ph: "<<min_W_ph<<" max_W_ph: "<<max_W_ph<<endl;
 	if (W<min_W_ph) return 1;
 	if (W>max_W_ph) return 2;
 	return 0;
 }
-double Sigma::int_get_d5CS(double Q,double W, double Ebeam){
+double inline Sigma::int_get_d5CS(double Q,double W, double Ebeam){
  double cache2=0;
  for (double cos=-1;cos<=1;cos+=0.02){
   //cout<<" cos: "<<cos<<endl;
@@ -1615,7 +1916,7 @@ double Sigma::int_get_d5CS(double Q,double W, double Ebeam){
  //cout<<cache2<<endl;
 	return cache2;
 }
-double Sigma::get_d5CS(double Q,double W, double cos, double fi, double Ebeam){
+double inline Sigma::get_d5CS(double Q,double W, double cos, double fi, double Ebeam){
  if (range_fi==1){
   fi=fi-180;
   if (abs(fi+180)<0.001) {fi=-179.9999;}
@@ -1673,6 +1974,7 @@ double Sigma::get_d5CS(double Q,double W, double cos, double fi, double Ebeam){
 			if (abs(W+0.15)<=5) res=intrep_CS(Q,W+0.15,cos,fi,1);
 			if (res>=0) return res;*/
 			//cout<<"ERROR:( CS<0 value: "<<tmp_res<<" Q: "<<Q<<" W: "<<W<<" cos: "<<cos<<" fi: "<<fi<<endl; return 0;
+			if (keepSign) return tmp_res;
 			return abs(tmp_res);
 		}
 	
@@ -1722,7 +2024,7 @@ double Sigma::get_d5CS(double Q,double W, double cos, double fi, double Ebeam){
  return 0;
 }
 
-double Sigma::get_d4CS(double Q,double W, double cos, double Ebeam){
+double inline Sigma::get_d4CS(double Q,double W, double cos, double Ebeam){
 	//cout<<" cos2: "<<_cos[3380]<<endl;
 
 	int test_Q2=check_possibil_inter_Q2(Q);
@@ -1780,7 +2082,7 @@ if ((test_W==3)&&(test_Q2==0)) {
 	return 0;
 }
 
-double Sigma::getCS_d3CS(double Q,double W, double Ebeam){
+double inline Sigma::getCS_d3CS(double Q,double W, double Ebeam){
 //cout<<" Q="<<Q<<" W="<<W<<endl;
 	bool check=check_kin(Q,W,Ebeam);
 	if (check==0) {cout<<" incorrect input_data"<<endl; return 0;}
@@ -1850,7 +2152,7 @@ if ((test_W==3)&&(test_Q2==0)) {
 }
 
 
-double Sigma::anti_Fit(double fi, double p0,double p1,double p2, int val){//anti_fit and integr po fi 1-anti_fit, 2-untegr po fi
+double inline Sigma::anti_Fit(double fi, double p0,double p1,double p2, int val){//anti_fit and integr po fi 1-anti_fit, 2-untegr po fi
 	if(val==1) return p0+p1*cos(2*fi/57.29578049)+p2*cos(fi/57.29578049);
 	if(val==2) return 2*3.1415926*p0;
 	cout<<"incorrect param anti_fit"<<endl;
@@ -1858,67 +2160,39 @@ double Sigma::anti_Fit(double fi, double p0,double p1,double p2, int val){//anti
 }
 
 //ERROR int 3-30 apperas if I run  W_test and Q2 test
-double Sigma::cos_in(int sp, double cos,double fi, int type){
-	for (int i=sp;_W[i]==_W[sp];i++){
-		if (abs(cos-_cos[i])<0.01) {// cout<<" ct=1 "; 
-				double tmp= anti_Fit(fi,_p0[i],_p1[i],_p2[i],type);
-				//cout<<" cos: "<<cos<<" fi: "<<fi<<" ty: "<<type<<" cos_val: "<<tmp<<" _p0[i]: "<<_p0[i]<<endl;
-				return tmp;
-		}
-		if ((cos>_cos[i])&&(cos<_cos[i+1])) {
-			//cout<<" cos type=2 "<<" cos: "<<cos<<" fi: "<<fi<<" ty: "<<type<<" cos_val(interp): "<<lin_interp(cos,_cos[i],_cos[i+1],anti_Fit(fi,_p0[i],_p1[i],_p2[i],type),anti_Fit(fi,_p0[i+1],_p1[i+1],_p2[i+1],type))<<" _p0[i]: "<<_p0[i]<<endl;
-			return lin_interp(cos,_cos[i],_cos[i+1],anti_Fit(fi,_p0[i],_p1[i],_p2[i],type),anti_Fit(fi,_p0[i+1],_p1[i+1],_p2[i+1],type));
-		}
-	}
-	/*
-	cout<<"ERROR int 3-30"<<" cos: "<<cos<<" fi: "<<fi<<" int_sp: "<<sp<<endl; 
-	for (int i=sp;_W[i]==_W[sp];i++){
-			cout<<"cos: "<<cos<<" _cos["<<i<<"]: "<<_cos[i]<<" Q[i]: "<<_Q2[i]<<" W[i]: "<<_W[i]<<" _p0[i] "<<_p0[i]<<endl;
-	}
-	*/
-	return 0;
+// sp is the first row of a W (cos_in), of a Q2 (W_in, W_in_part) block of CS_grid
+double inline Sigma::cos_in(int sp, double cos,double fi, int type){
+	int n1,n2;
+	int found=CS_grid.locate(2,sp,cos,0.01,n1,n2);
+	if (found==0) return 0;
+	const phi_params &a1=CS_grid.at(CS_grid.row(2,n1));
+	if (found==1) return anti_Fit(fi,a1.p0,a1.p1,a1.p2,type);
+	const phi_params &a2=CS_grid.at(CS_grid.row(2,n2));
+	return lin_interp(cos,CS_grid.node(2,n1),CS_grid.node(2,n2),anti_Fit(fi,a1.p0,a1.p1,a1.p2,type),anti_Fit(fi,a2.p0,a2.p1,a2.p2,type));
 }
-double Sigma::W_in(int sp,double W, double cos,double fi, int type){
-	for (int i=sp;_Q2[i]==_Q2[sp];i++){
-		if (W==_W[i]) {//cout<<" W type=1 W: "<<W<<endl;
-			return cos_in(i,cos,fi,type);}
-		if ((W>_W[i])&&(W<_W[i+1])) {//cout<<" W type=2 _W[i]: "<<_W[i]<<" _W[i+1]"<<_W[i+1]<<endl; 
-			int tmp=0;
-			for (int j=0;_W[i-j]==_W[i];j++){tmp=j;}
-			double tmp2=cos_in(i+1,cos,fi,type),tmp1=cos_in(i-tmp,cos,fi,type);
-			
-			return lin_interp(W,_W[i],_W[i+1],tmp1,tmp2);
-		}
+double inline Sigma::W_in(int sp,double W, double cos,double fi, int type){
+	int n1,n2;
+	int found=CS_grid.locate(1,sp,W,0.,n1,n2);
+	if (found==1) return cos_in(CS_grid.row(1,n1),cos,fi,type);
+	if (found==2) {
+		double tmp2=cos_in(CS_grid.row(1,n2),cos,fi,type),tmp1=cos_in(CS_grid.row(1,n1),cos,fi,type);
+		return lin_interp(W,CS_grid.node(1,n1),CS_grid.node(1,n2),tmp1,tmp2);
 	}
 	cout<<"ERROR int 3-4"<<endl; return 0;
 }
-double Sigma::intrep_CS_part(double Q,double W,double cos,double fi, int type_CS){
-	int sp_Q=-1,sp_Q1=-1,sp_Q2=-1,tp_int0=-1;
+double inline Sigma::intrep_CS_part(double Q,double W,double cos,double fi, int type_CS){
+	int n1,n2;
 	double W1=-1,W2=-1;
-	for (int i=0;i<n_str_CS;i++){
-		if (Q==_Q2[i]) {sp_Q=i; tp_int0=1; break;}
-		if ((Q>_Q2[i])&&(Q<_Q2[i+1])) {sp_Q2=i+1; tp_int0=2; 
-			int tmp=0;
-			for (int j=0;((_Q2[i-j]==_Q2[i])&&((i-j)>=0));j++){tmp=j;}
-			sp_Q1=i-tmp;
-			//cout<<" SP: "<<sp_Q1<<" i: "<<i<<" tmp: "<<tmp<<" _Q2[i]: "<<_Q2[i]<<" _Q2[sp_Q1]: "<<_Q2[sp_Q1]<<" _Q2[sp_Q1-1]: "<<_Q2[sp_Q1-1]<<endl;
-		break;}
-	}
-	if (((sp_Q==-1)&&(sp_Q1==-1))||(tp_int0==-1)) {cout<<" ERROR int3-1 "<<endl; return 0;}
-	if (tp_int0==1) {
-		return W1=W_in_part(sp_Q,W,cos,fi,type_CS);
-	}
-	if (tp_int0==2) {
-		//cout<<"!!!!!!!!!!!!!!! ERROR !!!!!!!!!!!!!!!!!!!!!!"<<endl;
-		W1=W_in_part(sp_Q1,W,cos,fi,type_CS);
-		W2=W_in_part(sp_Q2,W,cos,fi,type_CS);
-		return lin_interp(Q,_Q2[sp_Q1],_Q2[sp_Q2],W1,W2);
+	int found=CS_grid.locate(0,0,Q,0.,n1,n2);
+	if (found==0) {cout<<" ERROR int3-1 "<<endl; return 0;}
+	if (found==1) {
+		return W1=W_in_part(CS_grid.row(0,n1),W,cos,fi,type_CS);
 	}
-	cout<<"ERROR int final Q: "<<Q<<" W: "<<W<<" cos: "<<cos<<" fi: "<<fi<<endl; 
-	cout<<" sp_Q: "<<sp_Q<<" sp_Q1: "<<sp_Q1<<" tp_int0: "<<tp_int0<<endl; 
-	return 0;
+	W1=W_in_part(CS_grid.row(0,n1),W,cos,fi,type_CS);
+	W2=W_in_part(CS_grid.row(0,n2),W,cos,fi,type_CS);
+	return lin_interp(Q,CS_grid.node(0,n1),CS_grid.node(0,n2),W1,W2);
 }
-double Sigma::W_in_part(int sp,double W, double cos,double fi, int type){
+double inline Sigma::W_in_part(int sp,double W, double cos,double fi, int type){
 	if(W<_W[sp]){
 
 		double tmp_val1=cos_in(sp,cos,fi,type);
@@ -1929,88 +2203,85 @@ double Sigma::W_in_part(int sp,double W, double cos,double fi, int type){
 		//return tmp_val1*(W-porog_ch(type_chanel));
 
 	}
-	int chet=-1,chet2=0,pr=sp;
-	for (int i=sp;_Q2[i]==_Q2[sp];i++){
-		//cout<<" tp2=1"<<endl;
-		chet++;
-		//cout<<" W[i]: "<<_W[i]<<" _Q2[i]: "<<_Q2[i]<<" cos[i]: "<<_cos[i]<<endl;
-		if (W==_W[i]) {//cout<<" W type=1 W: "<<W<<endl;
-			double tmp_ch=cos_in(i,cos,fi,type);
-			//cout<<" tp2=1 final"<<endl;
-			return tmp_ch;}
-		if ((W>_W[i])&&(W<_W[i+1])) {//cout<<" W type=2 _W[i]: "<<_W[i]<<" _W[i+1]"<<_W[i+1]<<endl; 
-			int tmp=0;
-			for (int j=0;_W[i-j]==_W[i];j++){tmp=j;}
-			double tmp2=cos_in(i+1,cos,fi,type),tmp1=cos_in(i-tmp,cos,fi,type);
-
-			return lin_interp(W,_W[i],_W[i+1],tmp1,tmp2);
-		}
-		if (_W[pr]==_W[i]){chet2++;}
-		else{chet2=1;}
-		//cout<<" W[i]: "<<_W[i]<<" _W[pr]: "<<_W[pr]<<" chet2: "<<chet2<<endl;
-		pr=i;
-
+	int n1,n2;
+	int found=CS_grid.locate(1,sp,W,0.,n1,n2);
+	if (found==1) return cos_in(CS_grid.row(1,n1),cos,fi,type);
+	if (found==2) {
+		double tmp2=cos_in(CS_grid.row(1,n2),cos,fi,type),tmp1=cos_in(CS_grid.row(1,n1),cos,fi,type);
+		return lin_interp(W,CS_grid.node(1,n1),CS_grid.node(1,n2),tmp1,tmp2);
+	}
+	// above the last W of this Q2
+	int last=CS_grid.lastNode(1,sp);
+	double W_last=CS_grid.node(1,last);
+	if(W>W_last){
+		double tmp_val1=cos_in(CS_grid.row(1,last),cos,fi,type);
+		double tmp_val2=get_CS_ph(W,cos)/6.283;
+		double tmp_val3=get_CS_ph(W_last,cos)/6.283;
+		//if (W<W_ext_max) ph_fac=1.3;
+		//else ph_fac=1;
+		return tmp_val2=tmp_val2*tmp_val1/tmp_val3;
 	}
-	chet2--;
-	//cout<<"cos: "<<cos<<" _cos["<<sp+chet-chet2<<"]: "<<_cos[sp+chet-chet2]<<" Q[i]: "<<_Q2[sp+chet-chet2]<<" W[i]: "<<_W[sp+chet-chet2]<<" _p0[i] "<<_p0[sp+chet-chet2]<<" ch2: "<<chet2<<endl;
-	if ((_Q2[sp+chet-chet2]==_Q2[sp])&&(_Q2[sp+chet+1]!=_Q2[sp])&&(_W[sp+chet-chet2-1]!=_W[sp+chet-chet2])){
-
-		if(W>_W[sp+chet-chet2]){
-			double tmp_val1=cos_in(sp+chet-chet2,cos,fi,type);
-			double tmp_val2=get_CS_ph(W,cos)/6.283;
-			double tmp_val3=get_CS_ph(_W[sp+chet-chet2],cos)/6.283;
-			//if (W<W_ext_max) ph_fac=1.3;
-			//else ph_fac=1;
-			return tmp_val2=tmp_val2*tmp_val1/tmp_val3;
-		}
-	}else {cout<<"error in caclucl chet or chet2"<<endl;}
 
 	cout<<"ERROR int 3-4"<<endl; return 0;
 }
-double Sigma::intrep_CS(double Q,double W,double cos,double fi, int type_CS){
-	int sp_Q=-1,sp_Q1=-1,sp_Q2=-1,tp_int0=-1;
+double inline Sigma::intrep_CS(double Q,double W,double cos,double fi, int type_CS){
+	int n1,n2;
 	double W1=-1,W2=-1;
-
-	for (int i=0;i<n_str_CS;i++){
-		if (Q==_Q2[i]) {sp_Q=i; tp_int0=1; break;}
-		if ((Q>_Q2[i])&&(Q<_Q2[i+1])) {sp_Q2=i+1; tp_int0=2; 
-			int tmp=0;
-			for (int j=0;_Q2[i-j]==_Q2[i];j++){tmp=j;}
-			sp_Q1=i-tmp;
-		break;}
-	}
+	int found=CS_grid.locate(0,0,Q,0.,n1,n2);
 
 	//cout<<" Q: "<<Q<<" W: "<<W<<" cos: "<<cos<<" fi: "<<fi<<endl; 
-	//cout<<" sp_Q: "<<sp_Q<<" sp_Q1: "<<sp_Q1<<" tp_int0: "<<tp_int0<<endl; 
 
-	if (((sp_Q==-1)&&(sp_Q1==-1))||(tp_int0==-1)) {cout<<" ERROR int3-1 "<<endl; return 0;}
+	if (found==0) {cout<<" ERROR int3-1 "<<endl; return 0;}
 
-	if (tp_int0==1) {
-		return W1=W_in(sp_Q,W,cos,fi,type_CS);
+	if (found==1) {
+		return W1=W_in(CS_grid.row(0,n1),W,cos,fi,type_CS);
 	}
-	if (tp_int0==2) {
-		//cout<<"!!!!!!!!!!!!!!! ERROR !!!!!!!!!!!!!!!!!!!!!!"<<endl;
-		W1=W_in(sp_Q1,W,cos,fi,type_CS);
-		W2=W_in(sp_Q2,W,cos,fi,type_CS);
-		return lin_interp(Q,_Q2[sp_Q1],_Q2[sp_Q2],W1,W2);
+	//cout<<"!!!!!!!!!!!!!!! ERROR !!!!!!!!!!!!!!!!!!!!!!"<<endl;
+	W1=W_in(CS_grid.row(0,n1),W,cos,fi,type_CS);
+	W2=W_in(CS_grid.row(0,n2),W,cos,fi,type_CS);
+	return lin_interp(Q,CS_grid.node(0,n1),CS_grid.node(0,n2),W1,W2);
+}
+
+// intrep_CS in two steps, the same arithmetic: false if intrep_CS would fail
+bool inline Sigma::locate_CS(double Q,double W, CS_cell &cell){
+	int n[2];
+	int found=CS_grid.locate(0,0,Q,0.,n[0],n[1]);
+	if (found==0) return false;
+	cell.nQ=found;
+	for (int i=0;i<found;i++){
+		cell.Q[i]=CS_grid.node(0,n[i]);
+		int m[2];
+		int foundW=CS_grid.locate(1,CS_grid.row(0,n[i]),W,0.,m[0],m[1]);
+		if (foundW==0) return false;
+		cell.nW[i]=foundW;
+		for (int j=0;j<foundW;j++){
+			cell.W[i][j]=CS_grid.node(1,m[j]);
+			cell.row[i][j]=CS_grid.row(1,m[j]);
+		}
 	}
-	cout<<"ERROR int final Q: "<<Q<<" W: "<<W<<" cos: "<<cos<<" fi: "<<fi<<endl; 
-	cout<<" sp_Q: "<<sp_Q<<" sp_Q1: "<<sp_Q1<<" tp_int0: "<<tp_int0<<endl; 
-	
-	return 0;
+	return true;
+}
+double inline Sigma::intrep_CS(const CS_cell &cell,double Q,double W,double cos,double fi, int type_CS){
+	double val[2];
+	for (int i=0;i<cell.nQ;i++){
+		if (cell.nW[i]==1) val[i]=cos_in(cell.row[i][0],cos,fi,type_CS);
+		else val[i]=lin_interp(W,cell.W[i][0],cell.W[i][1],cos_in(cell.row[i][0],cos,fi,type_CS),cos_in(cell.row[i][1],cos,fi,type_CS));
+	}
+	if (cell.nQ==1) return val[0];
+	return lin_interp(Q,cell.Q[0],cell.Q[1],val[0],val[1]);
 }
 
-double min2(double a, double b){
+double inline min2(double a, double b){
 	if (a<=b) return a; 
 	else return b;
 return 0;
 }
-double max2(double a, double b){
+double inline max2(double a, double b){
 	if (a>=b) return a; 
 	else return b;
 return 0;
 }
-double min3(double a, double b, double c)
+double inline min3(double a, double b, double c)
 {
 	if (a<=b)
 	{
@@ -2023,7 +2294,7 @@ double min3(double a, double b, double c)
 		else return c;
 	}
 }
-double Sigma::lin_interp(double x,double point1, double point2, double value_point1, double value_point2){
+double inline Sigma::lin_interp(double x,double point1, double point2, double value_point1, double value_point2){
 
 	if (point1==point2){cout<<"ERROR 1"<<endl; return 0;}
 	if ((point2>=x)&&(x>=point1)) {double tmp_r1=value_point1+(x-point1)*(value_point2-value_point1)/(point2-point1);
@@ -2034,7 +2305,7 @@ double Sigma::lin_interp(double x,double point1, double point2, double value_poi
 	cout<<" x: "<<x<<" point1: "<<point1<<" point2: "<<point2<<endl;
 	return 0;
 }
-double Sigma::get_CS_ph(double W, double cos){
+double inline Sigma::get_CS_ph(double W, double cos){
 	int tmp0=range_ph(W);
 	if (tmp0==0) return ph_int(W,cos)*get_CS_ph_int_Ev(W)/get_CS_ph_int(W);
 	if (tmp0==1){
@@ -2048,7 +2319,7 @@ double Sigma::get_CS_ph(double W, double cos){
 	cout<<"ERROR in ph inter num 0"<<endl;
 	return 0;
 }
-double Sigma::get_CS_ph_int(double W){
+double inline Sigma::get_CS_ph_int(double W){
 	int tmp0=range_ph(W);
 	if (tmp0==0) return ph_int_int(W);
 	if (tmp0==1){
@@ -2062,7 +2333,7 @@ double Sigma::get_CS_ph_int(double W){
 	cout<<"ERROR in ph inter int num 0"<<endl;
 	return 0;
 }
-double Sigma::get_CS_ph_int_Ev(double W){
+double inline Sigma::get_CS_ph_int_Ev(double W){
 	int tmp0=range_ph(W);
 	if (tmp0==0) return ph_int_int_Ev(W);
 	if (tmp0==1){
@@ -2076,25 +2347,16 @@ double Sigma::get_CS_ph_int_Ev(double W){
 	cout<<"ERROR in ph inter int num 0"<<endl;
 	return 0;
 }
-double Sigma::cos_in_ph(int sp, double cos){
-	for (int i=sp;W_vec_ph[i]==W_vec_ph[sp];i++){
-		if (abs(cos-costeta_vec_ph[i])<0.01) { //cout<<" cos type=1 "; 
-				double tmp = CS_vec_ph[i];
-				//cout<<" cos: "<<cos<<" fi: "<<fi<<" ty: "<<type<<" cos_val: "<<tmp<<endl;
-				return tmp;
-		}
-		if ((cos>costeta_vec_ph[i])&&(cos<costeta_vec_ph[i+1])) {
-//cout<<" cos type=2 ";
-			return lin_interp(cos,costeta_vec_ph[i],costeta_vec_ph[i+1],CS_vec_ph[i],CS_vec_ph[i+1]);
-		}
-	}
+// sp is the first row of a W block of CS_ph_grid
+double inline Sigma::cos_in_ph(int sp, double cos){
+	int n1,n2;
+	int found=CS_ph_grid.locate(1,sp,cos,0.01,n1,n2);
+	if (found==1) return CS_ph_grid.at(CS_ph_grid.row(1,n1));
+	if (found==2) return lin_interp(cos,CS_ph_grid.node(1,n1),CS_ph_grid.node(1,n2),CS_ph_grid.at(CS_ph_grid.row(1,n1)),CS_ph_grid.at(CS_ph_grid.row(1,n2)));
 	cout<<"ERROR int ph 3-3"<<" cos: "<<cos<<endl; 
-	for (int i=sp;_W[i]==_W[sp];i++){
-			//cout<<"cos: "<<cos<<" _cos["<<i<<"]: "<<_cos[i]<<" Q[i]: "<<_Q2[i]<<" W[i]: "<<_W[i]<<" _p0[i] "<<_p0[i]<<endl;
-	}
 	return 0;
 }
-double Sigma::ph_int(double W, double cos){
+double inline Sigma::ph_int(double W, double cos){
 
 	int tmp0=range_ph(W);
 	if (tmp0!=0){
@@ -2102,32 +2364,19 @@ double Sigma::ph_int(double W, double cos){
 		{cout<<"error in ph int, too short W range in the photo data"<<endl; return 0;}
 	}
 
-	int sp_W=-1,sp_W1=-1,sp_W2=-1,tp_int0=-1;
-	double W1=-1,W2=-1;
-	for (int i=0;i<n_str_ph;i++){
-		if (W==W_vec_ph[i]) {sp_W=i; tp_int0=1; break;}
-		if ((W>W_vec_ph[i])&&(W<W_vec_ph[i+1])) {sp_W2=i+1; tp_int0=2; 
-			int tmp=0;
-			for (int j=0;W_vec_ph[i-j]==W_vec_ph[i];j++){tmp=j;}
-			sp_W1=i-tmp;
-		break;}
-	}
-
-	if (tp_int0==1) {
-		return W1=cos_in_ph(sp_W,cos);
-	}
-	if (tp_int0==2) {
-		//cout<<"!!!!!!!!!!!!!!! ERROR !!!!!!!!!!!!!!!!!!!!!!"<<endl;
-		W1=cos_in_ph(sp_W1,cos);
-		W2=cos_in_ph(sp_W2,cos);;
-		return lin_interp(W,W_vec_ph[sp_W1],W_vec_ph[sp_W2],W1,W2);
+	int n1,n2;
+	int found=CS_ph_grid.locate(0,0,W,0.,n1,n2);
+	if (found==1) return cos_in_ph(CS_ph_grid.row(0,n1),cos);
+	if (found==2) {
+		double W1=cos_in_ph(CS_ph_grid.row(0,n1),cos);
+		double W2=cos_in_ph(CS_ph_grid.row(0,n2),cos);
+		return lin_interp(W,CS_ph_grid.node(0,n1),CS_ph_grid.node(0,n2),W1,W2);
 	}
 	cout<<"ERROR int final PH: "<<" W: "<<W<<" cos: "<<cos<<endl; 
-	cout<<" sp_W: "<<sp_W<<" sp_W1: "<<sp_W1<<" tp_int0: "<<tp_int0<<endl; 
 	
 	return 0;
 }
-double Sigma::W_in_cs(int sp, double W){
+double inline Sigma::W_in_cs(int sp, double W){
 	for (int i=sp;_Q_int[i]==_Q_int[sp];i++){
 		if (abs(W-_W_int[i])<0.01) { //cout<<" cos type=1 "; 
 				double tmp = _CS_int[i];
@@ -2145,7 +2394,7 @@ double Sigma::W_in_cs(int sp, double W){
 	//}
 	return 0;
 }
-double Sigma::int_cos(double Q, double W){
+double inline Sigma::int_cos(double Q, double W){
 
 	int sp_Q=-1,sp_Q1=-1,sp_Q2=-1,tp_int0=-1;
 	double Q1=-1,Q2=-1;
@@ -2172,18 +2421,18 @@ double Sigma::int_cos(double Q, double W){
 	
 	return 0;
 }
-double Sigma::ph_int_int(double W){
+double inline Sigma::ph_int_int(double W){
 	for(int i=0;i<n_str_ph_int;i++){
 		if (W==_W_ph[i]) {return _CS_ph[i];}
 		if ((W>_W_ph[i])&&(W<_W_ph[i+1])) return lin_interp(W,_W_ph[i],_W_ph[i+1],_CS_ph[i],_CS_ph[i+1]);
 	}
 	return 0;
 }
-double Sigma::ph_int_int_Ev(double W){
-	for(int i=0;i<n_str_Ev;i++){
-		if (W==_W_ph_Ev[i]) {return _CS_ph_Ev[i];}
-		if ((W>_W_ph_Ev[i])&&(W<_W_ph_Ev[i+1])) return lin_interp(W,_W_ph_Ev[i],_W_ph_Ev[i+1],_CS_ph_Ev[i],_CS_ph_Ev[i+1]);
-	}
+double inline Sigma::ph_int_int_Ev(double W){
+	int i,i2;
+	int found=CS_ph_Ev_grid.locate(0,0,W,0.,i,i2);
+	if (found==1) {return CS_ph_Ev_grid.at(CS_ph_Ev_grid.row(0,i));}
+	if (found==2) return lin_interp(W,CS_ph_Ev_grid.node(0,i),CS_ph_Ev_grid.node(0,i2),CS_ph_Ev_grid.at(CS_ph_Ev_grid.row(0,i)),CS_ph_Ev_grid.at(CS_ph_Ev_grid.row(0,i2)));
 	return 0;
 }
 #endif 
@@ -11,14 +11,10 @@
 #include <cmath>
 #include <cstdlib>
 
-//ROOT LIBRARIES
-#include <TLorentzVector.h>
-
-#include <TRandom.h>
-#include <TRandom3.h>
-#include <TRandomGen.h>
 #include <sys/time.h>
 
+#include "rootCompat.h"
+
 
 #include "constants.h"
 
@@ -33,14 +29,24 @@ using namespace std;
 };
 
 
+// Seed of an independent random stream derived from a master seed
+// (SplitMix64 finalizer): nearby masters and streams give unrelated seeds.
+unsigned long long inline deriveSeed(unsigned long long master, unsigned long long stream) {
+  unsigned long long z = master + (stream+1)*0x9E3779B97F4A7C15ull;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+
 // print TLorentzVector
-void prnLV(string s, TLorentzVector v) {
+void inline prnLV(string s, TLorentzVector v) {
    cout << s << v.E() <<" "<< v.Px() <<" "<< v.Py() <<" "<< v.Pz() << endl;
 }
 
 
 // Legendre polinoms
-double PLeg(int l, double ct) {
+double inline PLeg(int l, double ct) {
   if     (l==0)  { return 1; }
   else if(l==1) { return ct; }
   else if(l==2) { return 0.5*(3*ct*ct - 1.); }
@@ -56,12 +62,12 @@ double PLeg(int l, double ct) {
 
 
 
-double getMax(int n, double a[]) {
+double inline getMax(int n, double a[]) {
   double amax=a[0];
   for(int i=0; i<n; i++) if(a[i]>amax) amax=a[i]; 
   return amax;
 }
-double getMax(int n, double a[], double b[]) {
+double inline getMax(int n, double a[], double b[]) {
   double amax=a[0];
   for(int i=0; i<n; i++) {
     if(a[i]>amax) amax=a[i]; 
@@ -69,7 +75,7 @@ double getMax(int n, double a[], double b[]) {
   } 
   return amax;
 }
-double getMin(int n, double a[]) {
+double inline getMin(int n, double a[]) {
   double amin=a[0];
   for(int i=0; i<n; i++) if(a[i]<amin) amin=a[i]; 
   return amin;
@@ -77,12 +83,49 @@ double getMin(int n, double a[]) {
 
 
 
-double getLoopVal(int N, double min, double max, int i) {
+double inline getLoopVal(int N, double min, double max, int i) {
   double val = min + (max-min) *i /(N-1.);
   return val;
 }
 
 
+// phi dependence of the cross section: f(phi) = a0 + a1*cos(2phi) + a2*cos(phi).
+// With c = cos(phi) it is the parabola a0 - a1 + a2*c + 2*a1*c^2, so the
+// extrema are at c = -1, c = 1 and at the vertex c = -a2/(4*a1).
+void inline harmonicsRange(double a0, double a1, double a2, double &fMin, double &fMax) {
+  double c[3] = {-1., 1., 0.};
+  int n = 2;
+  if(a1 != 0.) {
+    double cV = -a2/(4.*a1);
+    if(cV > -1. && cV < 1.) c[n++] = cV;
+  }
+  fMin = fMax = a0 - a1 + a2*c[0] + 2.*a1*c[0]*c[0];
+  for(int i=1; i<n; i++) {
+    double f = a0 - a1 + a2*c[i] + 2.*a1*c[i]*c[i];
+    if(f < fMin) fMin = f;
+    if(f > fMax) fMax = f;
+  }
+}
+
+// mean over the period of |f(phi)| if isAbs, else of max(f(phi), 0) (the
+// model gives a negative value as it is, the generator takes it as 0);
+// it is a0 unless f changes sign
+double inline harmonicsMean(double a0, double a1, double a2, bool isAbs) {
+  double fMin, fMax;
+  harmonicsRange(a0, a1, a2, fMin, fMax);
+  if(fMin >= 0.) return a0;
+  if(fMax <= 0.) return isAbs ? -a0 : 0.;
+  const int n = 720;
+  double sum = 0.;
+  for(int i=0; i<n; i++) {
+    double phi = 2.*constantPi*(i + 0.5)/n;
+    sum += fabs(a0 + a1*cos(2.*phi) + a2*cos(phi));
+  }
+  // the mean of f is a0: max(f, 0) = (|f| + f)/2
+  return isAbs ? sum/n : (sum/n + a0)/2.;
+}
+
+
 
 #endif
 
@@ -0,0 +1,123 @@
+#ifndef _VEGAS_GRID_H
+#define _VEGAS_GRID_H
+
+//SYS LIBRARIES
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+// Separable adaptive importance grid (VEGAS, G.P. Lepage 1978).
+// Every variable has its own set of nBins bins of variable width and
+// equal probability. A point is drawn by picking a bin per variable
+// uniformly and a uniform position inside it, so the proposal density
+// is the product of 1/(nBins*binWidth) over all variables.
+// The grid is trained by accumulating (f/q)^2 per bin and moving the
+// bin edges so that every bin gets the same share of it.
+class VegasGrid {
+
+  int nDim;
+  int nBins;
+  vector<double> xMin;
+  vector<double> xMax;
+  vector< vector<double> > edges;   // nDim x (nBins+1)
+  vector< vector<double> > d;       // nDim x nBins, accumulated (f/q)^2
+
+public:
+
+  VegasGrid(int n, const vector<double>& lo, const vector<double>& hi)
+    : nDim(lo.size()), nBins(n), xMin(lo), xMax(hi)
+  {
+    edges.assign(nDim, vector<double>(nBins+1));
+    d.assign(nDim, vector<double>(nBins, 0.));
+    for(int iDim=0; iDim<nDim; iDim++)
+      for(int i=0; i<=nBins; i++)
+        edges[iDim][i] = xMin[iDim] + (xMax[iDim]-xMin[iDim])*i/nBins;
+  }
+
+  int dim() const { return nDim; }
+
+  // map uniform numbers u[iDim] in [0,1) to a point x[iDim] of the box.
+  // bin[iDim] gets the bin index of every variable.
+  // Returns the jacobian 1/q(x), so f(x)*jacobian is the MC weight.
+  double map(const double* u, double* x, int* bin) const
+  {
+    double jacobian = 1.;
+    for(int iDim=0; iDim<nDim; iDim++) {
+      double pos = u[iDim]*nBins;
+      int i = (int)pos;
+      if(i >= nBins) i = nBins-1;
+      double width = edges[iDim][i+1] - edges[iDim][i];
+      x[iDim] = edges[iDim][i] + (pos-i)*width;
+      bin[iDim] = i;
+      jacobian *= nBins*width;
+    }
+    return jacobian;
+  }
+
+  // add (f/q)^2 of one training point to the bins it fell in
+  void accumulate(const int* bin, double weight)
+  {
+    double w2 = weight*weight;
+    for(int iDim=0; iDim<nDim; iDim++) d[iDim][bin[iDim]] += w2;
+  }
+
+  // move the bin edges according to the accumulated weights.
+  // alpha is the usual VEGAS damping exponent (1.5 is the standard value).
+  void refine(double alpha)
+  {
+    for(int iDim=0; iDim<nDim; iDim++) {
+      vector<double>& di = d[iDim];
+
+      // smooth with the neighbours, as in the original VEGAS
+      vector<double> s(nBins);
+      if(nBins == 1) s[0] = di[0];
+      else {
+        s[0] = (di[0] + di[1])/2.;
+        s[nBins-1] = (di[nBins-2] + di[nBins-1])/2.;
+        for(int i=1; i<nBins-1; i++) s[i] = (di[i-1] + di[i] + di[i+1])/3.;
+      }
+      double sum = 0.;
+      for(int i=0; i<nBins; i++) sum += s[i];
+      if(sum <= 0.) { di.assign(nBins, 0.); continue; }
+
+      // importance of every bin
+      vector<double> r(nBins, 0.);
+      double rSum = 0.;
+      for(int i=0; i<nBins; i++) {
+        double t = s[i]/sum;
+        if(t > 0. && t < 1.) r[i] = pow((t - 1.)/log(t), alpha);
+        else if(t >= 1.) r[i] = 1.;
+        rSum += r[i];
+      }
+      if(rSum <= 0.) { di.assign(nBins, 0.); continue; }
+      // keep every bin reachable: a bin with zero training weight
+      // must not collapse to zero width
+      double rFloor = 0.01*rSum/nBins;
+      rSum = 0.;
+      for(int i=0; i<nBins; i++) {
+        if(r[i] < rFloor) r[i] = rFloor;
+        rSum += r[i];
+      }
+
+      // new edges: every new bin gets rSum/nBins of importance
+      vector<double> newEdges(nBins+1);
+      newEdges[0] = xMin[iDim];
+      newEdges[nBins] = xMax[iDim];
+      double step = rSum/nBins;
+      double acc = 0.;
+      int j = 0;
+      for(int i=1; i<nBins; i++) {
+        while(acc + r[j] < step*i && j < nBins-1) { acc += r[j]; j++; }
+        double frac = (r[j] > 0.) ? (step*i - acc)/r[j] : 0.;
+        if(frac > 1.) frac = 1.;
+        newEdges[i] = edges[iDim][j] + frac*(edges[iDim][j+1] - edges[iDim][j]);
+      }
+      edges[iDim] = newEdges;
+      di.assign(nBins, 0.);
+    }
+  }
+
+};
+
+#endif